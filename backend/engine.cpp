@@ -96,12 +96,12 @@ static std::string normalize_difficulty(const std::string& difficulty) {
     return "medium";
 }
 
-static void apply_mode_to_core(const std::string& game_mode) {
-    const std::string m = normalize_mode(game_mode);
-    if (m == "marine")      g_game_mode = GameMode::MARINE_BATTLE;
-    else if (m == "air")    g_game_mode = GameMode::AIR_BATTLE;
-    else if (m == "land")   g_game_mode = GameMode::LAND_BATTLE;
-    else                    g_game_mode = GameMode::FULL_BATTLE;
+// The engine keeps no current mode; every rule check and search gets it from
+// the state it works on.
+static GameMode core_mode(const GameState& state) {
+    GameMode mode = GameMode::FULL_BATTLE;
+    parse_game_mode_token(normalize_mode(state.game_mode), mode);
+    return mode;
 }
 
 static void apply_difficulty_to_core(const std::string& difficulty) {
@@ -159,7 +159,7 @@ static ActionStatus finalize_apply(GameState& state, PieceList& pieces_after, co
     st.ok = true;
 
     // Win check follows original game flow: check before switching side.
-    std::string wm = check_win(pieces_after, string_to_player(mover));
+    std::string wm = check_win(pieces_after, string_to_player(mover), core_mode(state));
     if (!wm.empty()) {
         state.pieces = from_core(pieces_after);
         state.game_over = true;
@@ -188,6 +188,21 @@ static ActionStatus finalize_apply(GameState& state, PieceList& pieces_after, co
     return st;
 }
 
+// Installs a copy of a book image handed over in memory (WASM) or, with an
+// empty buffer, drops the current book and re-reads the configured path on
+// next use.
+static bool book_set_image(const uint8_t* data, std::size_t size) {
+    std::lock_guard<EngineMutex> lk(g_book_mutex);
+    g_book.reset();
+    g_book_tried = size != 0;
+    if (size == 0) return true;
+    auto book = std::make_unique<OpeningBook>();
+    book->file.adopt(std::vector<uint8_t>(data, data + size));
+    if (!book->attach()) return false;
+    g_book = std::move(book);
+    return true;
+}
+
 } // namespace
 
 GameState new_game(const std::string& game_mode, const std::string& difficulty) {
@@ -197,7 +212,6 @@ GameState new_game(const std::string& game_mode, const std::string& difficulty)
     out.game_mode = normalize_mode(game_mode);
     out.difficulty = normalize_difficulty(difficulty);
     apply_difficulty_to_state(out);
-    apply_mode_to_core(out.game_mode);
     PieceList p = make_initial_pieces();
     out.pieces = from_core(p);
     out.current = "red";
@@ -214,7 +228,6 @@ GameState new_game(const std::string& game_mode, const std::string& difficulty)
 
 ActionStatus apply_move(GameState& state, const Move& move) {
     ensure_engine_init();
-    apply_mode_to_core(state.game_mode);
     apply_difficulty_to_core(state.difficulty);
 
     ActionStatus st;
@@ -269,7 +282,6 @@ ActionStatus apply_move(GameState& state, const Move& move) {
 
 Move bot_move(GameState& state) {
     ensure_engine_init();
-    apply_mode_to_core(state.game_mode);
     state.difficulty = normalize_difficulty(state.difficulty);
     apply_runtime_search_to_core(state);
 
@@ -280,7 +292,10 @@ Move bot_move(GameState& state) {
     tt_clear();
     g_game_rep_history = state.position_history;
 
-    AIResult ai = cpu_pick_move(pieces, string_to_player(state.current), state.bot_depth, state.bot_time_limit);
+    const Player side = string_to_player(state.current);
+    const GameMode mode = core_mode(state);
+    AIResult ai = g_use_mcts ? portfolio_pick_move(pieces, side, mode, state.bot_depth, state.bot_time_limit)
+                             : cpu_pick_move(pieces, side, mode, state.bot_depth, state.bot_time_limit);
     if (!ai.found) return Move{-1, -1, -1};
 
     Move m{ai.move.pid, ai.move.dc, ai.move.dr};
@@ -289,9 +304,40 @@ Move bot_move(GameState& state) {
     return m;
 }
 
+bool load_opening_book(const uint8_t* data, std::size_t size) {
+    ensure_engine_init();
+    if (!data || size == 0) return false;
+    return book_set_image(data, size);
+}
+
+std::string position_text(const GameState& state) {
+    return position_to_text(to_core(state.pieces), string_to_player(state.current), core_mode(state));
+}
+
+bool parse_position_text(const std::string& text, GameState& out, std::string* error) {
+    ensure_engine_init();
+    PieceList pieces;
+    Player turn = Player::Red;
+    GameMode mode = GameMode::FULL_BATTLE;
+    // Same checks as the CLI --position: structurally sound, one Commander a side.
+    if (!parse_start_position(text, pieces, turn, mode, error)) return false;
+
+    GameState st = new_game(game_mode_token(mode), out.difficulty);
+    st.human_player = out.human_player;
+    st.bot_player = out.bot_player;
+    st.pieces = from_core(pieces);
+    st.current = player_to_string(turn);
+    st.position_history.clear();
+    push_position_history(st.position_history, zobrist_hash(pieces, turn));
+    // The side that just moved may already have won by another rule.
+    st.result = check_win(pieces, opp(turn), mode);
+    st.game_over = !st.result.empty();
+    out = std::move(st);
+    return true;
+}
+
 SerializedState serialize_state(const GameState& state) {
     ensure_engine_init();
-    apply_mode_to_core(state.game_mode);
     apply_difficulty_to_core(state.difficulty);
 
     SerializedState out;
@@ -305,6 +351,7 @@ SerializedState serialize_state(const GameState& state) {
     out.game_mode = normalize_mode(state.game_mode);
     out.difficulty = normalize_difficulty(state.difficulty);
     out.pieces = state.pieces;
+    out.position = position_text(state);
 
     if (state.game_over) return out;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -66,6 +67,7 @@ struct SerializedState {
 
     std::vector<PieceData> pieces;
     std::vector<Move> legal_moves;
+    std::string position; // compact notation, see position_text()
 };
 
 GameState new_game(const std::string& game_mode = "full",
@@ -73,5 +75,12 @@ GameState new_game(const std::string& game_mode = "full",
 ActionStatus apply_move(GameState& state, const Move& move);
 Move bot_move(GameState& state); // returns {-1,-1,-1} on failure
 SerializedState serialize_state(const GameState& state);
+// Compact position notation ("<board> <r|b> <mode>", see commander_chess.cpp).
+// Parsing starts a fresh game at that position; piece ids follow the text order.
+// Boards without exactly one Commander per side are rejected, and a position
+// that is already won comes back with game_over/result set.
+std::string position_text(const GameState& state);
+bool parse_position_text(const std::string& text, GameState& out, std::string* error = nullptr);
+bool load_opening_book(const uint8_t* data, std::size_t size); // .ccbk image; false if malformed
 
 } // namespace commander
@@ -90,6 +90,7 @@ json state_to_json(const commander::SerializedState& s) {
         {"last_move_player", s.last_move_player},
         {"game_mode", s.game_mode},
         {"difficulty", s.difficulty},
+        {"position", s.position},
         {"board", {{"cols", 11}, {"rows", 12}}}
     };
 }
@@ -292,13 +293,23 @@ CC_KEEPALIVE int cc_set_position(const char* state_json_or_fen) {
         return 0;
     }
 
+    commander::GameState parsed;
     json root = json::parse(state_json_or_fen, nullptr, false);
     if (root.is_discarded()) {
-        set_error("state parse failed; only JSON serialized state is supported");
-        return 0;
+        // Not JSON: compact position notation. Sides and difficulty carry over.
+        std::string why;
+        parsed.human_player = g_state.human_player;
+        parsed.bot_player = g_state.bot_player;
+        parsed.difficulty = g_state.difficulty;
+        if (!commander::parse_position_text(state_json_or_fen, parsed, &why)) {
+            set_error("invalid position: " + why);
+            return 0;
+        }
+        g_state = std::move(parsed);
+        g_initialized = true;
+        return 1;
     }
 
-    commander::GameState parsed;
     if (!parse_state_json(root, parsed)) {
         set_error("invalid state JSON");
         return 0;
@@ -367,6 +378,21 @@ CC_KEEPALIVE int cc_apply_move(const char* move_uci_or_custom) {
     return 1;
 }
 
+CC_KEEPALIVE int cc_load_opening_book(const unsigned char* data, int size) {
+    std::lock_guard<ApiMutex> lk(g_api_mu);
+    clear_error();
+
+    if (!data || size <= 0) {
+        set_error("missing opening book data");
+        return 0;
+    }
+    if (!commander::load_opening_book(data, (std::size_t)size)) {
+        set_error("invalid opening book image");
+        return 0;
+    }
+    return 1;
+}
+
 CC_KEEPALIVE const char* cc_get_last_error() {
     std::lock_guard<ApiMutex> lk(g_api_mu);
     return set_out_string(g_last_error);
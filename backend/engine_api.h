@@ -10,7 +10,8 @@ int cc_init();
 // Load a new game using existing mode/difficulty/human-side rules. Returns 1 on success.
 int cc_new_game(const char* game_mode, const char* difficulty, const char* human_player);
 
-// Set full game state from JSON (serialized state format). Returns 1 on success.
+// Set game state from JSON (serialized state format) or from compact position
+// notation, e.g. "6c4/.../6C4 r full". Returns 1 on success.
 int cc_set_position(const char* state_json_or_fen);
 
 // Get current game state as JSON string.
@@ -24,6 +25,9 @@ const char* cc_cpu_pick_move(int time_ms, int depth);
 // Apply move from JSON string ("pid/dc/dr"). Returns 1 on success.
 int cc_apply_move(const char* move_uci_or_custom);
 
+// Install a binary opening book image (.ccbk file bytes). Returns 1 on success.
+int cc_load_opening_book(const unsigned char* data, int size);
+
 // Retrieve last API error string.
 const char* cc_get_last_error();
 
@@ -121,6 +121,7 @@ json state_to_json(const commander::SerializedState& s) {
         {"last_move_player", s.last_move_player},
         {"game_mode", s.game_mode},
         {"difficulty", s.difficulty},
+        {"position", s.position},
         {"board", {{"cols", 11}, {"rows", 12}}}
     }};
 }
@@ -212,6 +213,7 @@ int main() {
         std::string human = "red";
         std::string game_mode = "full";
         std::string difficulty = "medium";
+        std::string position;
         if (!req.body.empty()) {
             json in = safe_parse(req.body, res);
             if (in.is_discarded()) return;
@@ -226,10 +228,18 @@ int main() {
             if (in.is_object() && in.contains("difficulty")) {
                 difficulty = normalize_difficulty(in.value("difficulty", "medium"));
             }
+            if (in.is_object() && in.contains("position") && in["position"].is_string()) {
+                position = in.value("position", "");
+            }
         }
         commander::GameState st = commander::new_game(game_mode, difficulty);
         st.human_player = human;
         st.bot_player = (human == "red") ? "blue" : "red";
+        std::string why;
+        if (!position.empty() && !commander::parse_position_text(position, st, &why)) {
+            set_secure_json(res, 400, json{{"error", "invalid position: " + why}});
+            return;
+        }
         if (st.current == st.bot_player) {
             commander::bot_move(st);
         }
@@ -78,8 +78,11 @@
 #include <atomic>
 #include <cassert>
 #include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <csignal>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -192,6 +195,22 @@ using EngineMutex = EngineNoopMutex;
 #include <immintrin.h>
 #endif
 
+// Tablebases and the opening book are memory-mapped where POSIX mmap exists;
+// there the test-suite runner can also fork worker processes.
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define COMMANDER_HAS_MMAP 1
+#define COMMANDER_HAS_FORK 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#define COMMANDER_HAS_MMAP 0
+#define COMMANDER_HAS_FORK 0
+#endif
+
 #if defined(COMMANDER_ENABLE_WEBGPU) && COMMANDER_ENABLE_WEBGPU
 #if __has_include(<webgpu/webgpu.h>)
 #include <webgpu/webgpu.h>
@@ -866,9 +885,22 @@ struct BB132 {
     inline bool test(int sq) const {
         return (w[sq >> 6] & (1ULL << (sq & 63))) != 0;
     }
+    inline void reset(int sq) {
+        w[sq >> 6] &= ~(1ULL << (sq & 63));
+    }
     inline void or_bits(const BB132& o) {
         w[0] |= o.w[0]; w[1] |= o.w[1]; w[2] |= o.w[2];
     }
+    inline void and_bits(const BB132& o) {
+        w[0] &= o.w[0]; w[1] &= o.w[1]; w[2] &= o.w[2];
+    }
+    inline void and_not_bits(const BB132& o) {
+        w[0] &= ~o.w[0]; w[1] &= ~o.w[1]; w[2] &= ~o.w[2];
+    }
+    inline bool any() const { return (w[0] | w[1] | w[2]) != 0; }
+    inline bool intersects(const BB132& o) const {
+        return ((w[0] & o.w[0]) | (w[1] & o.w[1]) | (w[2] & o.w[2])) != 0;
+    }
 };
 
 static int bb_popcount(const BB132& b) {
@@ -1320,6 +1352,103 @@ static bool has_legal_destination(const Piece& piece, const PieceList& pieces,
     return has_legal_destination_with_ctx(piece, ctx, dc, dr);
 }
 
+// ── Targeted generation (captures / evasions) ─────────────────────────────
+// Quiescence only wants moves landing on a small target set (enemy pieces,
+// or the Commander's empty escape squares). Every capture in this game —
+// including Navy/Tank stay-and-fire and AF bombardment — lands on a square
+// within the piece's Chebyshev reach, so a piece whose reach box misses the
+// target mask cannot produce a targeted move and its full mask is skipped.
+static constexpr int MAX_CAPTURE_REACH = 5; // AF/Navy range 4 + hero
+static BB132 g_reach_box[COLS * ROWS][MAX_CAPTURE_REACH + 1];
+static bool g_reach_boxes_ready = false;
+
+static void init_reach_boxes() {
+    if (g_reach_boxes_ready) return;
+    for (int sq = 0; sq < COLS * ROWS; sq++) {
+        int c0 = sq_col(sq), r0 = sq_row(sq);
+        for (int rad = 0; rad <= MAX_CAPTURE_REACH; rad++) {
+            BB132& b = g_reach_box[sq][rad];
+            b.clear();
+            for (int r = std::max(0, r0 - rad); r <= std::min(ROWS - 1, r0 + rad); r++)
+                for (int c = std::max(0, c0 - rad); c <= std::min(COLS - 1, c0 + rad); c++)
+                    b.set(sq_index(c, r));
+        }
+    }
+    g_reach_boxes_ready = true;
+}
+
+// Upper bound on the Chebyshev distance of any capture `piece` can make.
+static inline int capture_reach(const Piece& piece) {
+    int h = piece.hero ? 1 : 0;
+    switch (piece.kind) {
+        case PieceKind::Commander:    return 1;          // captures adjacent only
+        case PieceKind::HQ:           return piece.hero ? 2 : 0;
+        case PieceKind::Infantry:
+        case PieceKind::Militia:
+        case PieceKind::Engineer:
+        case PieceKind::AntiAircraft: return 1 + h;
+        case PieceKind::Tank:
+        case PieceKind::Missile:      return 2 + h;
+        case PieceKind::Artillery:    return 3 + h;      // fire ring is range 3
+        case PieceKind::AirForce:
+        case PieceKind::Navy:         return 4 + h;
+        default: break;
+    }
+    return MAX_CAPTURE_REACH;
+}
+
+// Destination mask restricted to `targets`. Equivalent to
+// get_move_mask_bitboard(piece, ctx) & targets, but returns early when the
+// piece cannot reach any target square.
+static inline BB132 get_targeted_mask_bitboard(const Piece& piece, const MoveGenContext& ctx,
+                                               const BB132& targets) {
+    BB132 res;
+    if (!on_board(piece.col, piece.row)) return res;
+    int reach = std::min(capture_reach(piece), MAX_CAPTURE_REACH);
+    if (!targets.intersects(g_reach_box[sq_index(piece.col, piece.row)][reach])) return res;
+    res = get_move_mask_bitboard(piece, ctx);
+    res.and_bits(targets);
+    return res;
+}
+
+// Capture-only generation: every (piece, target) pair for `player` whose
+// destination is an enemy-occupied square. Includes stay-and-fire and
+// bombardment captures, which the move mask already encodes as landings.
+template <typename Fn>
+static void for_each_capture(const PieceList& pieces, const MoveGenContext& ctx,
+                             Player player, Fn&& fn) {
+    const BB132& targets = ctx.occ_by_player[1 - player_idx(player)];
+    if (!targets.any()) return;
+    for (const auto& p : pieces) {
+        if (p.player != player) continue;
+        BB132 bb = get_targeted_mask_bitboard(p, ctx, targets);
+        while (true) {
+            int sq = bb_pop_lsb(bb);
+            if (sq < 0) break;
+            fn(p, sq);
+        }
+    }
+}
+
+// Evasion-only generation: quiet Commander moves to empty escape squares.
+// Captures by the Commander are already produced by for_each_capture().
+template <typename Fn>
+static void for_each_commander_evasion(const PieceList& pieces, const MoveGenContext& ctx,
+                                       Player player, Fn&& fn) {
+    int csq = ctx.commander_sq[player_idx(player)];
+    if (csq < 0) return;
+    int ci = ctx.sq_to_piece[(std::size_t)csq];
+    if (ci < 0) return;
+    const Piece& cmd = pieces[(std::size_t)ci];
+    BB132 bb = get_move_mask_bitboard(cmd, ctx);
+    bb.and_not_bits(ctx.occ_all);
+    while (true) {
+        int sq = bb_pop_lsb(bb);
+        if (sq < 0) break;
+        fn(cmd, sq);
+    }
+}
+
 static bool square_capturable_by_player(const PieceList& pieces, int col, int row,
                                         Player by_player) {
     if (!on_board(col, row)) return false;
@@ -1402,7 +1531,6 @@ enum class GameMode {
     AIR_BATTLE,    // First side to destroy 2 enemy Air Forces wins.
     LAND_BATTLE,   // First side to destroy 2 Tanks + 2 Infantry + 2 Artillery wins.
 };
-static GameMode g_game_mode = GameMode::FULL_BATTLE;
 
 static const char* game_mode_name(GameMode mode) {
     switch (mode) {
@@ -1414,41 +1542,67 @@ static const char* game_mode_name(GameMode mode) {
     }
 }
 
-static std::string check_win(const PieceList& pieces, Player last) {
+// ── Mode-specialized win rules ────────────────────────────────────────────
+// Rules are instantiated once per GameMode so terminal tests inside the search
+// are branch-free. Search code picks the instantiation from SearchState::mode
+// (set from the mode every search entry point takes); callers outside the
+// search pass the mode of their own game.
+template <GameMode M>
+static constexpr bool is_objective_kind(PieceKind k) {
+    if constexpr (M == GameMode::MARINE_BATTLE) return k == PieceKind::Navy;
+    else if constexpr (M == GameMode::AIR_BATTLE) return k == PieceKind::AirForce;
+    else if constexpr (M == GameMode::LAND_BATTLE)
+        return k == PieceKind::Tank || k == PieceKind::Infantry || k == PieceKind::Artillery;
+    else return false;
+}
+
+// True once `last` has won: the enemy Commander is gone, or (variants) the
+// enemy's whole objective division is destroyed.
+template <GameMode M>
+static bool side_has_won_t(const PieceList& pieces, Player last) {
     Player op = opp(last);
-    int cnt_C=0, cnt_N=0, cnt_Af=0, cnt_T=0, cnt_In=0, cnt_A=0;
+    bool has_cmd = false, has_objective = false;
     for (auto& p : pieces) {
-        if (p.player != op) continue;
-        if (!on_board(p.col, p.row)) continue;
-        if (p.kind == PieceKind::Commander)  cnt_C++;
-        if (p.kind == PieceKind::Navy)  cnt_N++;
-        if (p.kind == PieceKind::AirForce) cnt_Af++;
-        if (p.kind == PieceKind::Tank)  cnt_T++;
-        if (p.kind == PieceKind::Infantry) cnt_In++;
-        if (p.kind == PieceKind::Artillery)  cnt_A++;
-    }
-    bool commander_captured = (cnt_C == 0);
-
-    switch (g_game_mode) {
-    case GameMode::MARINE_BATTLE:
-        if (commander_captured) return player_to_string(last) + " wins — Commander captured!";
-        if (cnt_N == 0)         return player_to_string(last) + " wins — Naval division destroyed!";
-        break;
-    case GameMode::AIR_BATTLE:
-        if (commander_captured) return player_to_string(last) + " wins — Commander captured!";
-        if (cnt_Af == 0)        return player_to_string(last) + " wins — Air Force destroyed!";
-        break;
-    case GameMode::LAND_BATTLE:
-        if (commander_captured) return player_to_string(last) + " wins — Commander captured!";
-        if (cnt_T == 0 && cnt_In == 0 && cnt_A == 0)
-            return player_to_string(last) + " wins — Land division destroyed!";
-        break;
+        if (p.player != op || !on_board(p.col, p.row)) continue;
+        if (p.kind == PieceKind::Commander) has_cmd = true;
+        else if (is_objective_kind<M>(p.kind)) has_objective = true;
+    }
+    if (!has_cmd) return true;
+    if constexpr (M == GameMode::FULL_BATTLE) return false;
+    else return !has_objective;
+}
+
+template <GameMode M>
+static std::string check_win_t(const PieceList& pieces, Player last) {
+    if (!side_has_won_t<M>(pieces, last)) return "";
+    bool commander_captured = true;
+    for (auto& p : pieces)
+        if (p.player == opp(last) && p.kind == PieceKind::Commander && on_board(p.col, p.row))
+            commander_captured = false;
+    if (commander_captured) return player_to_string(last) + " wins — Commander captured!";
+    if constexpr (M == GameMode::MARINE_BATTLE) return player_to_string(last) + " wins — Naval division destroyed!";
+    else if constexpr (M == GameMode::AIR_BATTLE) return player_to_string(last) + " wins — Air Force destroyed!";
+    else return player_to_string(last) + " wins — Land division destroyed!";
+}
+
+// Calls fn(std::integral_constant<GameMode, M>{}) for the runtime `mode`.
+template <typename Fn>
+static decltype(auto) dispatch_game_mode(GameMode mode, Fn&& fn) {
+    switch (mode) {
+    case GameMode::MARINE_BATTLE: return fn(std::integral_constant<GameMode, GameMode::MARINE_BATTLE>{});
+    case GameMode::AIR_BATTLE:    return fn(std::integral_constant<GameMode, GameMode::AIR_BATTLE>{});
+    case GameMode::LAND_BATTLE:   return fn(std::integral_constant<GameMode, GameMode::LAND_BATTLE>{});
     case GameMode::FULL_BATTLE:
-    default:
-        if (commander_captured) return player_to_string(last) + " wins — Commander captured!";
-        break;
+    default:                      return fn(std::integral_constant<GameMode, GameMode::FULL_BATTLE>{});
     }
-    return "";
+}
+
+static bool side_has_won(const PieceList& pieces, Player last, GameMode mode) {
+    return dispatch_game_mode(mode, [&](auto m) { return side_has_won_t<decltype(m)::value>(pieces, last); });
+}
+
+static std::string check_win(const PieceList& pieces, Player last, GameMode mode) {
+    return dispatch_game_mode(mode, [&](auto m) { return check_win_t<decltype(m)::value>(pieces, last); });
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -1929,16 +2083,62 @@ static AllMoves all_moves_for(const PieceList& pieces, Player player) {
     return result;
 }
 
-// True if `player` can win immediately in one move from `pieces`.
-static bool has_immediate_winning_move(const PieceList& pieces, Player player) {
+// Reference implementation: plays every legal move and re-checks the win.
+template <GameMode M>
+static bool has_immediate_winning_move_slow_t(const PieceList& pieces, Player player) {
     AllMoves moves = all_moves_for(pieces, player);
     for (auto& m : moves) {
         PieceList np = apply_move(pieces, m.pid, m.dc, m.dr, player);
-        if (!check_win(np, player).empty()) return true;
+        if (side_has_won_t<M>(np, player)) return true;
+    }
+    return false;
+}
+
+// True if `player` can win immediately in one move from `pieces`.
+// A capture removes the whole stack on the destination square (carried
+// pieces go with their carrier), and nothing else is ever removed from the
+// enemy: AF interception destroys the attacker only after the target is
+// gone, and stay-and-fire / bombardment captures land on the target square in
+// the move mask. So a one-move win exists iff some piece can reach a square
+// holding the enemy Commander or, in the variants, every remaining enemy
+// objective unit — answered from destination masks without making moves.
+template <GameMode M>
+static bool has_immediate_winning_move_t(const PieceList& pieces, Player player) {
+    // Degenerate: already won, so any legal move "wins". Rare; keep it exact.
+    if (side_has_won_t<M>(pieces, player)) return has_immediate_winning_move_slow_t<M>(pieces, player);
+
+    const Player op = opp(player);
+    BB132 targets;
+    int objective_sq = -1, objective_total = 0, objective_on_sq = 0;
+    for (const auto& p : pieces) {
+        if (p.player != op || !on_board(p.col, p.row)) continue;
+        const int sq = sq_index(p.col, p.row); // carried pieces share the carrier's square
+        if (p.kind == PieceKind::Commander) targets.set(sq);
+        else if (is_objective_kind<M>(p.kind)) {
+            objective_total++;
+            if (objective_sq < 0) objective_sq = sq;
+            if (sq == objective_sq) objective_on_sq++;
+        }
+    }
+    if constexpr (M != GameMode::FULL_BATTLE) {
+        if (objective_total > 0 && objective_on_sq == objective_total) targets.set(objective_sq);
+    }
+    if (!targets.any()) return false;
+
+    MoveGenContext ctx = build_movegen_context(pieces);
+    for (const auto& p : pieces) {
+        if (p.player != player) continue;
+        if (get_targeted_mask_bitboard(p, ctx, targets).any()) return true;
     }
     return false;
 }
 
+static bool has_immediate_winning_move(const PieceList& pieces, Player player, GameMode mode) {
+    return dispatch_game_mode(mode, [&](auto m) {
+        return has_immediate_winning_move_t<decltype(m)::value>(pieces, player);
+    });
+}
+
 static inline uint64_t zobrist_piece_key(const Piece& p);
 
 static int quick_piece_unit_score(const Piece& p) {
@@ -1986,6 +2186,8 @@ struct SearchState {
     int phase_material = 0;
     int phase = 0;
     int cpu_side = 0;
+    // Rules variant, fixed for the whole search (selects the template instantiation).
+    GameMode mode = GameMode::FULL_BATTLE;
     // O(1) lookups for hot search paths.
     std::array<int16_t, COLS * ROWS> sq_to_piece_idx{};
     std::array<int16_t, kFastIdMax> id_to_piece_idx{};
@@ -2041,7 +2243,7 @@ struct UndoMove {
 };
 
 static SearchState make_search_state(const PieceList& pieces, Player turn,
-                                     Player cpu_player);
+                                     Player cpu_player, GameMode mode);
 
 static int find_piece_idx_by_id(const PieceList& pieces, int pid) {
     for (int i = 0; i < (int)pieces.size(); i++) if (pieces[i].id == pid) return i;
@@ -2066,6 +2268,50 @@ static inline int find_piece_idx_at_fast(const SearchState& st, int col, int row
     return (int)st.sq_to_piece_idx[(std::size_t)sq_index(col, row)];
 }
 
+// ── Single-move pseudo-legality ───────────────────────────────────────────
+// Checks one (piece, destination) pair against that piece's own mask, using
+// the SearchState's live square/commander caches instead of a full
+// build_movegen_context() pass. Only the AA coverage the mask reads (enemy
+// cover, and only for Air Force) is computed.
+static bool piece_move_is_pseudo_legal(const SearchState& st, const Piece& piece, int dc, int dr) {
+    if (!on_board(dc, dr) || !on_board(piece.col, piece.row)) return false;
+    MoveGenContext ctx;
+    ctx.pieces = &st.pieces;
+    for (int sq = 0; sq < COLS * ROWS; sq++)
+        ctx.sq_to_piece[(std::size_t)sq] = st.sq_to_piece_idx[(std::size_t)sq];
+    for (int pl = 0; pl < 2; pl++) {
+        int ci = (st.cmd_col[pl] >= 0) ? find_piece_idx_at_fast(st, st.cmd_col[pl], st.cmd_row[pl]) : -1;
+        if (ci >= 0 && st.pieces[(std::size_t)ci].kind == PieceKind::Commander)
+            ctx.commander_sq[pl] = sq_index(st.cmd_col[pl], st.cmd_row[pl]);
+    }
+    if (piece.kind == PieceKind::AirForce && !piece.hero) {
+        int enemy = 1 - player_idx(piece.player);
+        for (const Piece& q : st.pieces) {
+            if (player_idx(q.player) != enemy || !on_board(q.col, q.row)) continue;
+            int radius = 0;
+            if (q.kind == PieceKind::AntiAircraft || q.kind == PieceKind::Navy) radius = 1;
+            else if (q.kind == PieceKind::Missile) radius = 2;
+            if (radius == 0) continue;
+            for (int r = std::max(0, q.row - radius); r <= std::min(ROWS - 1, q.row + radius); r++)
+                for (int c = std::max(0, q.col - radius); c <= std::min(COLS - 1, q.col + radius); c++)
+                    ctx.aa_cover_by_player[enemy].set(sq_index(c, r));
+        }
+    }
+    return get_move_mask_bitboard(piece, ctx).test(sq_index(dc, dr));
+}
+
+// True if `m` is a pseudo-legal move for the side to move in `st`.
+// Used to trust TT/killer moves and single API/book moves without
+// generating the full move list.
+static bool move_is_pseudo_legal(const SearchState& st, const MoveTriple& m) {
+    if (!on_board(m.dc, m.dr)) return false;
+    int idx = find_piece_idx_by_id_fast(st, m.pid);
+    if (idx < 0) return false;
+    const Piece& p = st.pieces[(std::size_t)idx];
+    if (p.player != st.turn) return false;
+    return piece_move_is_pseudo_legal(st, p, m.dc, m.dr);
+}
+
 static bool validate_state(const PieceList& pieces) {
     constexpr int kFastIdMax = 512;
     std::array<uint8_t, kFastIdMax> id_seen{};
@@ -2104,7 +2350,7 @@ static bool validate_state(const PieceList& pieces) {
 
 // Sim-mode validator: catches corrupted states early and prints useful crash context.
 static bool validate_state_for_sim(const PieceList& pieces,
-                                   Player last_mover,
+                                   Player last_mover, GameMode mode,
                                    std::string* reason = nullptr) {
     constexpr int kFastIdMax = 512;
     std::array<uint8_t, kFastIdMax> id_seen{};
@@ -2181,7 +2427,7 @@ static bool validate_state_for_sim(const PieceList& pieces,
 
     // Terminal commander-capture states are allowed if they are a legal win state.
     bool terminal_ok = (red_cmd == 0 && blue_cmd == 1) || (red_cmd == 1 && blue_cmd == 0);
-    if (terminal_ok && !check_win(pieces, last_mover).empty()) return true;
+    if (terminal_ok && !check_win(pieces, last_mover, mode).empty()) return true;
 
     if (reason) {
         *reason = "invalid commander count (red=" + std::to_string(red_cmd) +
@@ -2190,6 +2436,302 @@ static bool validate_state_for_sim(const PieceList& pieces,
     return false;
 }
 
+// ═══════════════════════════════════════════════════════════════════════════
+// POSITION NOTATION
+// ═══════════════════════════════════════════════════════════════════════════
+// Compact FEN-like text for a position, used by the C API, the backend and
+// the command-line tools:
+//
+//   <board> <side to move> [<mode>]
+//
+// The board lists the ranks from row 11 (Blue's back rank) down to row 0,
+// separated by '/'. Each rank runs from column 0 to column 10; a number is a
+// run of empty squares. Pieces are one letter, upper case for Red and lower
+// case for Blue:
+//   C Commander  H HQ  I Infantry  M Militia  T Tank  E Engineer
+//   A Artillery  D AntiAircraft  R Missile  F AirForce  N Navy
+// A '+' after the letter marks a hero, and the pieces a carrier holds follow
+// it in parentheses, e.g. "N(FT)" or "F+(I)". Side to move is 'r' or 'b';
+// the mode is full | marine | air | land and defaults to full. Piece ids are
+// assigned in the order the pieces appear. The initial setup is
+//   6c4/1n2fh1hf2/3a2r2a1/2n1dt1td2/2ie2m2ei/11/11/2IE2M2EI/2N1DT1TD2/3A2R2A1/1N2FH1HF2/6C4 r full
+
+static char kind_to_notation(PieceKind k) {
+    switch (k) {
+        case PieceKind::HQ: return 'H';
+        case PieceKind::Commander: return 'C';
+        case PieceKind::Infantry: return 'I';
+        case PieceKind::Militia: return 'M';
+        case PieceKind::Tank: return 'T';
+        case PieceKind::Engineer: return 'E';
+        case PieceKind::Artillery: return 'A';
+        case PieceKind::AntiAircraft: return 'D';
+        case PieceKind::Missile: return 'R';
+        case PieceKind::AirForce: return 'F';
+        case PieceKind::Navy: return 'N';
+        default: return '?';
+    }
+}
+
+static PieceKind notation_to_kind(char ch) {
+    switch (std::toupper((unsigned char)ch)) {
+        case 'H': return PieceKind::HQ;
+        case 'C': return PieceKind::Commander;
+        case 'I': return PieceKind::Infantry;
+        case 'M': return PieceKind::Militia;
+        case 'T': return PieceKind::Tank;
+        case 'E': return PieceKind::Engineer;
+        case 'A': return PieceKind::Artillery;
+        case 'D': return PieceKind::AntiAircraft;
+        case 'R': return PieceKind::Missile;
+        case 'F': return PieceKind::AirForce;
+        case 'N': return PieceKind::Navy;
+        default: return PieceKind::None;
+    }
+}
+
+static const char* game_mode_token(GameMode mode) {
+    switch (mode) {
+    case GameMode::MARINE_BATTLE: return "marine";
+    case GameMode::AIR_BATTLE:    return "air";
+    case GameMode::LAND_BATTLE:   return "land";
+    case GameMode::FULL_BATTLE:
+    default: return "full";
+    }
+}
+
+static bool parse_game_mode_token(const std::string& s, GameMode& out) {
+    if (s == "full") out = GameMode::FULL_BATTLE;
+    else if (s == "marine") out = GameMode::MARINE_BATTLE;
+    else if (s == "air") out = GameMode::AIR_BATTLE;
+    else if (s == "land") out = GameMode::LAND_BATTLE;
+    else return false;
+    return true;
+}
+
+// `carried` lists the indices of all pieces that have a carrier.
+static void append_notation_piece(std::string& out, const PieceList& pieces,
+                                  const int16_t* carried, int n_carried, const Piece& p) {
+    const char ch = kind_to_notation(p.kind);
+    out += (p.player == Player::Blue) ? (char)std::tolower((unsigned char)ch) : ch;
+    if (p.hero) out += '+';
+    bool open = false;
+    for (int k = 0; k < n_carried; k++) {
+        const Piece& q = pieces[(std::size_t)carried[k]];
+        if (q.carrier_id != p.id) continue;
+        if (!open) out += '(';
+        open = true;
+        append_notation_piece(out, pieces, carried, n_carried, q);
+    }
+    if (open) out += ')';
+}
+
+static std::string position_to_text(const PieceList& pieces, Player turn, GameMode mode) {
+    std::array<int16_t, COLS * ROWS> top;
+    top.fill(-1);
+    std::array<int16_t, PieceList::kMaxPieces> carried;
+    int n_carried = 0;
+    for (std::size_t i = 0; i < pieces.size(); i++) {
+        const Piece& p = pieces[i];
+        if (p.carrier_id >= 0) carried[(std::size_t)n_carried++] = (int16_t)i;
+        else if (on_board(p.col, p.row)) top[(std::size_t)sq_index(p.col, p.row)] = (int16_t)i;
+    }
+    std::string out;
+    out.reserve(112);
+    auto flush_empty = [&out](int& empty) {
+        if (empty >= 10) out += '1';
+        if (empty) out += (char)('0' + empty % 10);
+        empty = 0;
+    };
+    for (int r = ROWS - 1; r >= 0; r--) {
+        int empty = 0;
+        for (int c = 0; c < COLS; c++) {
+            const int16_t i = top[(std::size_t)sq_index(c, r)];
+            if (i < 0) { empty++; continue; }
+            flush_empty(empty);
+            append_notation_piece(out, pieces, carried.data(), n_carried, pieces[(std::size_t)i]);
+        }
+        flush_empty(empty);
+        if (r > 0) out += '/';
+    }
+    out += (turn == Player::Blue) ? " b " : " r ";
+    out += game_mode_token(mode);
+    return out;
+}
+
+// Parses the notation above. Carrier pairings and capacities are checked as
+// the stacks close, so a successful parse always passes validate_state. If `end` is given, parsing stops after the optional mode
+// field and `*end` is the offset of whatever follows (EPD-style operations);
+// otherwise trailing text is an error.
+static bool position_from_text(const std::string& text, PieceList& pieces, Player& turn,
+                               GameMode& mode, std::string* error = nullptr,
+                               std::size_t* end = nullptr) {
+    const std::size_t n = text.size();
+    std::size_t i = 0;
+    auto fail = [&](const std::string& why) {
+        if (error) *error = why + " (at offset " + std::to_string(i) + ")";
+        return false;
+    };
+    auto skip_space = [&]() {
+        while (i < n && std::isspace((unsigned char)text[i])) i++;
+    };
+    auto next_token = [&]() {
+        skip_space();
+        std::size_t b = i;
+        while (i < n && !std::isspace((unsigned char)text[i])) i++;
+        return text.substr(b, i - b);
+    };
+
+    PieceList out;
+    constexpr int kMaxNesting = 4;
+    std::array<int16_t, kMaxNesting> open{}; // indices of carriers whose '(' is open
+    std::array<std::size_t, kMaxNesting> carrier_at{}; // and their offsets in `text`
+    int depth = 0;
+    int16_t last = -1; // last piece at the current level; takes '+' and '('
+    std::size_t last_at = 0;
+    int row = ROWS - 1, col = 0;
+    skip_space();
+    for (; i < n && !std::isspace((unsigned char)text[i]); i++) {
+        const char ch = text[i];
+        if (ch >= '0' && ch <= '9') {
+            if (depth) return fail("empty-square count inside a carrier");
+            int run = ch - '0';
+            if (i + 1 < n && text[i + 1] >= '0' && text[i + 1] <= '9') run = run * 10 + (text[++i] - '0');
+            if (run == 0 || col + run > COLS) return fail("rank " + std::to_string(row) + " is wider than 11 columns");
+            col += run;
+            last = -1;
+        } else if (ch == '/') {
+            if (depth) return fail("unclosed '('");
+            if (col != COLS) return fail("rank " + std::to_string(row) + " has " + std::to_string(col) + " columns, expected 11");
+            if (--row < 0) return fail("more than 12 ranks");
+            col = 0;
+            last = -1;
+        } else if (ch == '+') {
+            if (last < 0 || out[(std::size_t)last].hero) return fail("'+' must follow a piece letter");
+            out[(std::size_t)last].hero = true;
+        } else if (ch == '(') {
+            if (last < 0) return fail("'(' must follow a carrier");
+            if (depth == kMaxNesting) return fail("carriers nested too deeply");
+            carrier_at[(std::size_t)depth] = last_at;
+            open[(std::size_t)depth++] = last;
+            last = -1;
+        } else if (ch == ')') {
+            if (depth == 0) return fail("unmatched ')'");
+            if (text[i - 1] == '(') return fail("empty carrier stack");
+            const Piece& carrier = out[(std::size_t)open[(std::size_t)--depth]];
+            if (!carrier_capacity_valid(out, carrier.id, carrier.kind))
+                return fail(std::string("'") + text[carrier_at[(std::size_t)depth]] + "' carries too many pieces");
+            last = -1;
+        } else {
+            const PieceKind kind = notation_to_kind(ch);
+            if (kind == PieceKind::None) return fail(std::string("unknown piece letter '") + ch + "'");
+            if (out.size() >= PieceList::kMaxPieces) return fail("too many pieces");
+            const Player player = std::isupper((unsigned char)ch) ? Player::Red : Player::Blue;
+            Piece p{(int16_t)out.size(), player, kind, (int8_t)col, (int8_t)row, false, -1};
+            if (depth) {
+                const Piece& carrier = out[(std::size_t)open[(std::size_t)depth - 1]];
+                if (carrier.player != player || !can_carry_kind(carrier.kind, kind))
+                    return fail(std::string("'") + text[(std::size_t)carrier_at[(std::size_t)depth - 1]] +
+                                "' cannot carry '" + ch + "'");
+                p.col = carrier.col;
+                p.carrier_id = (int8_t)carrier.id;
+            } else {
+                if (col >= COLS) return fail("rank " + std::to_string(row) + " is wider than 11 columns");
+                col++;
+            }
+            last = (int16_t)out.size();
+            last_at = i;
+            out.push_back(p);
+        }
+    }
+    if (depth) return fail("unclosed '('");
+    if (row != 0 || col != COLS) return fail("board must have 12 ranks of 11 columns");
+    if (out.empty()) return fail("board has no pieces");
+
+    const std::string side = next_token();
+    if (side == "r" || side == "red") turn = Player::Red;
+    else if (side == "b" || side == "blue") turn = Player::Blue;
+    else return fail(side.empty() ? "missing side to move" : "side to move must be 'r' or 'b'");
+
+    mode = GameMode::FULL_BATTLE;
+    std::size_t field = i;
+    const std::string mode_token = next_token();
+    if (!mode_token.empty() && !parse_game_mode_token(mode_token, mode)) {
+        if (!end) return fail("unknown game mode '" + mode_token + "'");
+        i = field;
+    }
+    skip_space();
+    if (end) *end = i;
+    else if (i < n) return fail("unexpected trailing text");
+
+    pieces = out;
+    return true;
+}
+
+// position_from_text() plus what a game needs to start from the position: the
+// sim's structural checks and exactly one Commander per side (a won or lost
+// board parses fine but cannot be played on).
+static bool parse_start_position(const std::string& text, PieceList& pieces, Player& turn,
+                                 GameMode& mode, std::string* error = nullptr) {
+    PieceList parsed;
+    Player parsed_turn = Player::Red;
+    GameMode parsed_mode = GameMode::FULL_BATTLE;
+    if (!position_from_text(text, parsed, parsed_turn, parsed_mode, error)) return false;
+    if (!validate_state_for_sim(parsed, opp(parsed_turn), parsed_mode, error)) return false;
+    int commanders[2] = {0, 0};
+    for (const Piece& p : parsed)
+        if (p.kind == PieceKind::Commander) commanders[player_idx(p.player)]++;
+    if (commanders[0] != 1 || commanders[1] != 1) {
+        if (error) *error = "each side needs exactly one Commander (red=" + std::to_string(commanders[0]) +
+                            ", blue=" + std::to_string(commanders[1]) + ")";
+        return false;
+    }
+    pieces = std::move(parsed);
+    turn = parsed_turn;
+    mode = parsed_mode;
+    return true;
+}
+
+// Moves are written "<piece><col>,<row>-<col>,<row>", e.g. "T5,3-5,5"; 'x'
+// may replace '-'. The piece letter tells stacked pieces apart and can be
+// left out when only one piece on the square makes that move.
+static std::string move_to_text(const PieceList& pieces, const MoveTriple& m) {
+    const Piece* p = piece_by_id_c(pieces, m.pid);
+    if (!p) return "?";
+    std::string out(1, kind_to_notation(p->kind));
+    out += std::to_string(p->col) + "," + std::to_string(p->row) + "-" +
+           std::to_string(m.dc) + "," + std::to_string(m.dr);
+    return out;
+}
+
+// Resolves `text` to one of `side`'s moves in `pieces`; false if no move or
+// more than one matches.
+static bool move_from_text(const std::string& text, const PieceList& pieces, Player side, MoveTriple& out) {
+    PieceKind kind = PieceKind::None;
+    std::size_t i = 0;
+    if (!text.empty() && std::isalpha((unsigned char)text[0])) {
+        kind = notation_to_kind(text[0]);
+        if (kind == PieceKind::None) return false;
+        i = 1;
+    }
+    int fc = 0, fr = 0, tc = 0, tr = 0, used = 0;
+    char sep = 0;
+    if (std::sscanf(text.c_str() + i, "%d,%d%c%d,%d%n", &fc, &fr, &sep, &tc, &tr, &used) != 5 ||
+        (sep != '-' && sep != 'x') || i + (std::size_t)used != text.size())
+        return false;
+    bool found = false;
+    for (const MoveTriple& m : all_moves_for(pieces, side)) {
+        if (m.dc != tc || m.dr != tr) continue;
+        const Piece* p = piece_by_id_c(pieces, m.pid);
+        if (!p || p->col != fc || p->row != fr) continue;
+        if (kind != PieceKind::None && p->kind != kind) continue;
+        if (found && !same_move(out, m)) return false;
+        out = m;
+        found = true;
+    }
+    return found;
+}
+
 static void build_attack_cache(SearchState& st) {
     if (st.atk.valid && st.atk.key == st.hash) return;
     memset(st.atk.counts, 0, sizeof(st.atk.counts));
@@ -2327,6 +2869,13 @@ struct EngineConfig {
     int max_depth = 8;
     int time_limit_ms = 3000;
     int mcts_ab_depth = 3;
+    std::size_t mcts_arena_mb = 64;   // MCTS node pool, rewound per search
+    int mcts_eval_batch = 0;          // MCTS leaves per evaluator batch; 0 = backend default
+    bool mcts_transpositions = true;  // share MCTS subtrees and leaf values between transpositions
+    bool mcts_progressive_widening = true; // grow the PUCT candidate set with parent visits
+    int pns_node_budget = 20000;      // df-pn root solver (variant endgames); 0 = off
+    std::string tablebase_dir = "tablebases"; // Full Battle endgame tables; "" = off
+    std::string opening_book_path = "opening_book.ccbk"; // binary book; "" = built-in heuristics
     bool force_single_thread = false; // WASM-SAFE: true in browser builds.
 };
 
@@ -2339,6 +2888,10 @@ static EngineConfig default_engine_config() {
     cfg.max_depth = 8;
     cfg.time_limit_ms = 3000;
     cfg.mcts_ab_depth = 2;
+    cfg.mcts_arena_mb = 16;
+    cfg.pns_node_budget = 5000;
+    cfg.tablebase_dir.clear();
+    cfg.opening_book_path.clear(); // the host installs the book image (cc_load_opening_book)
     cfg.force_single_thread = true;
 #endif
     return cfg;
@@ -2485,6 +3038,7 @@ static uint64_t splitmix64_next(uint64_t& x) {
 static void init_zobrist() {
     uint64_t seed = 0xC0FFEE1234567890ULL;
     init_ray_tables();
+    init_reach_boxes();
     for (int st = 0; st < ZK_STATES; st++)
         for (int sq = 0; sq < ZK_SQUARES; sq++)
             g_ZK_piece_sq[st][sq] = splitmix64_next(seed);
@@ -2515,11 +3069,12 @@ static inline uint64_t zobrist_piece_key(const Piece& p) {
 }
 
 static SearchState make_search_state(const PieceList& pieces, Player turn,
-                                     Player cpu_player) {
+                                     Player cpu_player, GameMode mode) {
     SearchState st;
     st.pieces = pieces;
     st.turn = turn;
     st.cpu_side = (cpu_player == Player::Red) ? 0 : 1;
+    st.mode = mode;
     st.hash = zobrist_hash(st.pieces, st.turn) ^ zobrist_cpu_perspective_salt(cpu_player);
     st.atk.valid = false;
     st.rebuild_caches();
@@ -2535,9 +3090,7 @@ static bool make_move_inplace_snapshot(SearchState& st, const MoveTriple& m,
     int moved_idx = find_piece_idx_by_id_fast(st, m.pid);
     if (moved_idx < 0) return false;
     if (st.pieces[moved_idx].player != st.turn) return false;
-
-    MoveGenContext mg_ctx = build_movegen_context(st.pieces);
-    if (!has_legal_destination_with_ctx(st.pieces[moved_idx], mg_ctx, m.dc, m.dr)) return false;
+    if (!piece_move_is_pseudo_legal(st, st.pieces[moved_idx], m.dc, m.dr)) return false;
 
     u.snapshot_pieces = st.pieces;
     u.turn_before = st.turn;
@@ -2694,7 +3247,7 @@ static uint64_t perft_impl(SearchState& st, int depth, Player cpu_player) {
 }
 
 static uint64_t perft(const PieceList& pieces, Player turn, int depth) {
-    SearchState st = make_search_state(pieces, turn, turn);
+    SearchState st = make_search_state(pieces, turn, turn, GameMode::FULL_BATTLE);
     return perft_impl(st, depth, turn);
 }
 
@@ -2706,37 +3259,98 @@ static uint64_t perft(int depth) {
 // ── Killer moves & History ─────────────────────────────────────────────────
 static const int MAX_PLY = 32;
 
-// Board dimensions for history indexing: [player][kind][col][row]
-static const int H_PLAYERS = 2, H_KINDS = 11, H_COLS = 11, H_ROWS = 12;
+// History indexing: [player][kind][square]; continuation tables index the
+// previous move by the moving piece's slot (id modulo H_SLOTS).
+static const int H_PLAYERS = 2, H_KINDS = 11, H_SQ = COLS * ROWS, H_SLOTS = 40;
+static const int HIST_MAX = 32000; // gravity bound; fits int16_t
+
+// ── History tables ────────────────────────────────────────────────────────
+// Square-indexed int16 tables (~187 KB total, L2-resident):
+//   main  [side][kind][to]           butterfly-style quiet history   (5.7 KB)
+//   cont1 [prev_slot][kind][to]      previous ply's mover → this move (113 KB)
+//   cont2 [own_to 2 plies ago][to]   own previous move → this move     (34 KB)
+//   cont4 [own_to 4 plies ago][to]   own move before that → this move  (34 KB)
+// cont1 is laid out so every lookup at a node stays inside one 2.9 KB block.
+// Tables persist across searches and are halved by decay() instead of wiped.
+struct HistoryTables {
+    int16_t main[H_PLAYERS][H_KINDS][H_SQ];
+    int16_t cont1[H_SLOTS][H_KINDS][H_SQ];
+    int16_t cont2[H_SQ][H_SQ];
+    int16_t cont4[H_SQ][H_SQ];
+
+    void clear() { memset(this, 0, sizeof(*this)); }
+
+    void decay() {
+        auto halve = [](int16_t* v, std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) v[i] = (int16_t)(v[i] / 2);
+        };
+        halve(&main[0][0][0], sizeof(main) / sizeof(int16_t));
+        halve(&cont1[0][0][0], sizeof(cont1) / sizeof(int16_t));
+        halve(&cont2[0][0], sizeof(cont2) / sizeof(int16_t));
+        halve(&cont4[0][0], sizeof(cont4) / sizeof(int16_t));
+    }
+};
+
+// Stockfish-style gravity: bonus - entry * |bonus| / HIST_MAX keeps the
+// entry inside [-HIST_MAX, HIST_MAX] without a hard reset.
+static inline void hist_gravity(int16_t& entry, int bonus) {
+    int v = entry;
+    v += bonus - v * std::abs(bonus) / HIST_MAX;
+    entry = (int16_t)std::max(-HIST_MAX, std::min(HIST_MAX, v));
+}
+
+static inline int hist_bonus(int depth) { return std::min(depth * depth, 1600); }
+
+// Moves played along the current search path, by ply (thread-local so the
+// SMP/MCTS workers each see their own line). Feeds cont2/cont4.
+static thread_local MoveTriple g_ply_move[MAX_PLY + 1];
+
+static inline int hist_slot(const MoveTriple* m) {
+    if (!m || m->pid < 0 || !on_board(m->dc, m->dr)) return -1;
+    return m->pid % H_SLOTS;
+}
+
+static inline int ply_move_sq_back(int ply, int back) {
+    int i = ply - back;
+    if (i < 0 || i > MAX_PLY) return -1;
+    const MoveTriple& m = g_ply_move[i];
+    if (!on_board(m.dc, m.dr)) return -1;
+    return sq_index(m.dc, m.dr);
+}
 
 // ── Per-thread search data for Lazy SMP ──────────────────────────────────
 struct alignas(64) ThreadData {
     MoveTriple killers[MAX_PLY][2];
     bool killers_set[MAX_PLY][2];
-    // Flat history: [player][kind_index][col][row] — O(1) access, memset-clearable
-    int history[H_PLAYERS][H_KINDS][H_COLS][H_ROWS];
-    // Flat continuation history: [prev_col][prev_row][kind_index][col][row]
-    int16_t cont_history[H_COLS][H_ROWS][H_KINDS][H_COLS][H_ROWS];
+    HistoryTables hist;
     MoveTriple pv[MAX_PLY][MAX_PLY];
     int pv_len[MAX_PLY];
     MoveTriple counter[11][12];
     bool counter_set[11][12];
     int thread_id = 0;
-
-    void reset() {
-        memset(history, 0, sizeof(history));
-        memset(cont_history, 0, sizeof(cont_history));
+    // Running TT probe/hit counts; the SMP scaling report derives duplicated
+    // work from their per-search deltas.
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+
+    // Per-search state (killers, PV, counters) is cleared; history decays.
+    void new_search() {
+        hist.decay();
         for (int i = 0; i < MAX_PLY; i++) killers_set[i][0] = killers_set[i][1] = false;
         memset(pv_len, 0, sizeof(pv_len));
         memset(counter_set, 0, sizeof(counter_set));
     }
+
+    void reset() {
+        hist.clear();
+        new_search();
+    }
 };
 
 // Legacy globals — flat arrays for single-thread fallback & headless sim
 static MoveTriple g_killers[MAX_PLY][2];
 static bool g_killers_set[MAX_PLY][2];
-static int g_history[H_PLAYERS][H_KINDS][H_COLS][H_ROWS];
-static int16_t g_cont_history[H_COLS][H_ROWS][H_KINDS][H_COLS][H_ROWS];
+static HistoryTables g_hist;
 
 // ── Correction History forward declarations (full implementation below SEE) ─
 static const int CORR_HIST_SIZE     = 16384;
@@ -2761,8 +3375,7 @@ static void reset_search_tables() {
     // Don't wipe TT — just age it so old entries get displaced naturally
     g_tt_age++;
     init_lmr_table();
-    memset(g_history, 0, sizeof(g_history));
-    memset(g_cont_history, 0, sizeof(g_cont_history));
+    g_hist.decay();
     for (int i=0; i<MAX_PLY; i++) g_killers_set[i][0]=g_killers_set[i][1]=false;
     memset(g_pv_len, 0, sizeof(g_pv_len));
     memset(g_counter_set, 0, sizeof(g_counter_set));
@@ -2776,17 +3389,19 @@ static void reset_search_tables() {
             for (int i = 0; i < CORR_TERR_SIZE; i++) g_corr_hist_terrain[pi][i] /= 2;
         }
     }
-    g_default_td.reset();
+    g_default_td.new_search();
 }
 
 // ── TT probe / store ──────────────────────────────────────────────────────
-static const TTDecoded* tt_probe(uint64_t h) {
+static const TTDecoded* tt_probe(uint64_t h, ThreadData* td) {
     if (!g_TT) return nullptr;
+    if (td) td->tt_probes++;
     const TTCluster& c = g_TT[h & g_tt_mask];
     TTDecoded d0{}, d1{};
     bool h0 = tt_read_slot(c.e[0], d0) && d0.key == h;
     bool h1 = tt_read_slot(c.e[1], d1) && d1.key == h;
     if (!h0 && !h1) return nullptr;
+    if (td) td->tt_hits++;
     static thread_local TTDecoded out{};
     if (h0 && h1) {
         bool d0_current = (d0.age == g_tt_age);
@@ -2821,6 +3436,25 @@ static void tt_store(uint64_t h, int depth, int flag, int val, MoveTriple best)
     tt_write_slot(c.e[1], h, depth, flag, val, best, g_tt_age);
 }
 
+// Quiescence store (depth <= 0). Q-entries are plentiful and cheap to
+// recompute, so they may only displace empty, stale, same-key or other
+// q-entries — never a current main-search result (depth > 0) in either slot.
+static void tt_store_qs(uint64_t h, int depth, int flag, int val, MoveTriple best) {
+    if (!g_TT) return;
+    TTCluster& c = g_TT[h & g_tt_mask];
+    for (int i = 0; i < TT_BUCKET; i++) {
+        TTDecoded d{};
+        bool valid = tt_read_slot(c.e[i], d);
+        bool replaceable = !valid || d.age != g_tt_age ||
+                           (d.key == h ? d.depth <= depth : d.depth <= 0);
+        if (valid && d.key == h && !replaceable) return; // deeper result already cached
+        if (replaceable) {
+            tt_write_slot(c.e[i], h, depth, flag, val, best, g_tt_age);
+            return;
+        }
+    }
+}
+
 static void store_killer(const MoveTriple& m, int ply) {
     if (ply >= MAX_PLY) return;
     if (!g_killers_set[ply][0] || !(g_killers[ply][0].pid==m.pid && g_killers[ply][0].dc==m.dc && g_killers[ply][0].dr==m.dr)) {
@@ -2842,78 +3476,85 @@ static void td_store_killer(ThreadData& td, const MoveTriple& m, int ply) {
     }
 }
 
+static inline bool hist_index_ok(int pl, int ki, int dc, int dr) {
+    return pl >= 0 && pl < H_PLAYERS && ki >= 0 && ki < H_KINDS && on_board(dc, dr);
+}
+
+static int hist_main_score(const HistoryTables& h, int pl, int ki, int dc, int dr) {
+    if (!hist_index_ok(pl, ki, dc, dr)) return 0;
+    return h.main[pl][ki][sq_index(dc, dr)];
+}
+
+static void hist_main_update(HistoryTables& h, int pl, int ki, int dc, int dr, int bonus) {
+    if (!hist_index_ok(pl, ki, dc, dr)) return;
+    hist_gravity(h.main[pl][ki][sq_index(dc, dr)], bonus);
+}
+
+// Sum of the continuation tables for a quiet move at `ply` (prev = ply-1 move).
+static int hist_cont_score(const HistoryTables& h, const MoveTriple* prev, int ply,
+                           int ki, int dc, int dr) {
+    if (ki < 0 || ki >= H_KINDS || !on_board(dc, dr)) return 0;
+    int to = sq_index(dc, dr);
+    int score = 0;
+    int s1 = hist_slot(prev);
+    if (s1 >= 0) score += h.cont1[s1][ki][to];
+    int s2 = ply_move_sq_back(ply, 2);
+    if (s2 >= 0) score += h.cont2[s2][to];
+    int s4 = ply_move_sq_back(ply, 4);
+    if (s4 >= 0) score += h.cont4[s4][to] / 2;
+    return score;
+}
+
+static void hist_cont_update(HistoryTables& h, const MoveTriple* prev, int ply,
+                             int ki, int dc, int dr, int bonus) {
+    if (ki < 0 || ki >= H_KINDS || !on_board(dc, dr)) return;
+    int to = sq_index(dc, dr);
+    int s1 = hist_slot(prev);
+    if (s1 >= 0) hist_gravity(h.cont1[s1][ki][to], bonus);
+    int s2 = ply_move_sq_back(ply, 2);
+    if (s2 >= 0) hist_gravity(h.cont2[s2][to], bonus);
+    int s4 = ply_move_sq_back(ply, 4);
+    if (s4 >= 0) hist_gravity(h.cont4[s4][to], bonus);
+}
+
 static int td_history_score(const ThreadData& td, int pl, int ki, int dc, int dr) {
-    if (pl<0||pl>=H_PLAYERS||ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return 0;
-    return td.history[pl][ki][dc][dr];
+    return hist_main_score(td.hist, pl, ki, dc, dr);
 }
 
 static void td_update_history(ThreadData& td, int pl, int ki, int dc, int dr, int depth) {
-    if (pl<0||pl>=H_PLAYERS||ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return;
-    int& v = td.history[pl][ki][dc][dr];
-    int bonus = std::min(depth * depth, 1600);
-    v += bonus - v * std::abs(bonus) / 32000;
-    v = std::max(-32000, std::min(32000, v));
+    hist_main_update(td.hist, pl, ki, dc, dr, hist_bonus(depth));
 }
 
 static void td_penalise_history(ThreadData& td, int pl, int ki, int dc, int dr, int depth) {
-    if (pl<0||pl>=H_PLAYERS||ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return;
-    int& v = td.history[pl][ki][dc][dr];
-    int malus = -std::min(depth * depth, 1600);
-    v += malus - v * std::abs(malus) / 32000;
-    v = std::max(-32000, std::min(32000, v));
+    hist_main_update(td.hist, pl, ki, dc, dr, -hist_bonus(depth));
 }
 
-static int td_cont_history_score(const ThreadData& td, const MoveTriple* prev, int ki, int dc, int dr) {
-    if (!prev || !on_board(prev->dc, prev->dr)) return 0;
-    if (ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return 0;
-    return (int)td.cont_history[prev->dc][prev->dr][ki][dc][dr];
+static int td_cont_history_score(const ThreadData& td, const MoveTriple* prev, int ply, int ki, int dc, int dr) {
+    return hist_cont_score(td.hist, prev, ply, ki, dc, dr);
 }
 
-static void td_update_cont_history(ThreadData& td, const MoveTriple* prev, int ki, int dc, int dr, int depth) {
-    if (!prev || !on_board(prev->dc, prev->dr)) return;
-    if (ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return;
-    int bonus = std::min(depth * depth, 1600);
-    int v = (int)td.cont_history[prev->dc][prev->dr][ki][dc][dr];
-    v += bonus - v * std::abs(bonus) / 32000;
-    td.cont_history[prev->dc][prev->dr][ki][dc][dr] = (int16_t)std::max(-32000, std::min(32000, v));
+static void td_update_cont_history(ThreadData& td, const MoveTriple* prev, int ply, int ki, int dc, int dr, int depth) {
+    hist_cont_update(td.hist, prev, ply, ki, dc, dr, hist_bonus(depth));
 }
 
 static int history_score(int pl, int ki, int dc, int dr) {
-    if (pl<0||pl>=H_PLAYERS||ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return 0;
-    return g_history[pl][ki][dc][dr];
+    return hist_main_score(g_hist, pl, ki, dc, dr);
 }
 
 static void update_history(int pl, int ki, int dc, int dr, int depth) {
-    if (pl<0||pl>=H_PLAYERS||ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return;
-    int& v = g_history[pl][ki][dc][dr];
-    // Stockfish 18 gravity: bonus - entry * |bonus| / MAX_HISTORY
-    // This naturally decays old values and prevents saturation.
-    int bonus = std::min(depth * depth, 1600);
-    v += bonus - v * std::abs(bonus) / 32000;
-    v = std::max(-32000, std::min(32000, v));
+    hist_main_update(g_hist, pl, ki, dc, dr, hist_bonus(depth));
 }
 
 static void penalise_history(int pl, int ki, int dc, int dr, int depth) {
-    if (pl<0||pl>=H_PLAYERS||ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return;
-    int& v = g_history[pl][ki][dc][dr];
-    int malus = -std::min(depth * depth, 1600);
-    v += malus - v * std::abs(malus) / 32000;
-    v = std::max(-32000, std::min(32000, v));
+    hist_main_update(g_hist, pl, ki, dc, dr, -hist_bonus(depth));
 }
 
-static int cont_history_score(const MoveTriple* prev, int ki, int dc, int dr) {
-    if (!prev || !on_board(prev->dc, prev->dr)) return 0;
-    if (ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return 0;
-    return (int)g_cont_history[prev->dc][prev->dr][ki][dc][dr];
+static int cont_history_score(const MoveTriple* prev, int ply, int ki, int dc, int dr) {
+    return hist_cont_score(g_hist, prev, ply, ki, dc, dr);
 }
 
-static void update_cont_history(const MoveTriple* prev, int ki, int dc, int dr, int depth) {
-    if (!prev || !on_board(prev->dc, prev->dr)) return;
-    if (ki<0||ki>=H_KINDS||dc<0||dc>=H_COLS||dr<0||dr>=H_ROWS) return;
-    int bonus = std::min(depth * depth, 1600);
-    int v = (int)g_cont_history[prev->dc][prev->dr][ki][dc][dr];
-    v += bonus - v * std::abs(bonus) / 32000;
-    g_cont_history[prev->dc][prev->dr][ki][dc][dr] = (int16_t)std::max(-32000, std::min(32000, v));
+static void update_cont_history(const MoveTriple* prev, int ply, int ki, int dc, int dr, int depth) {
+    hist_cont_update(g_hist, prev, ply, ki, dc, dr, hist_bonus(depth));
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -3129,6 +3770,125 @@ static int see(const PieceList& pieces, int col, int row,
     return gain - see(np, col, row, opp(attacker_player), depth+1);
 }
 
+// Threshold SEE: true when the exchange that `m` starts on its target square
+// nets the mover at least `threshold`. Swap-list form: each side recaptures
+// with its least valuable attacker, found by re-testing that side's masks
+// against a context that is updated in place as pieces leave their squares
+// (so sliders behind them join the exchange). Follows the capture rules of
+// apply_move_impl_inplace: stay-and-fire Navy/Tank captures and Air Force
+// bombardments of a defended square end the sequence with nothing left to
+// recapture, and a non-hero Air Force landing inside enemy AA cover is lost.
+static bool see_ge(const SearchState& st, const MoveGenContext& base,
+                   const MoveTriple& m, int threshold) {
+    const int ai = find_piece_idx_by_id_fast(st, m.pid);
+    const int ti = find_piece_idx_at_fast(st, m.dc, m.dr);
+    if (ai < 0 || ti < 0) return 0 >= threshold;
+    const PieceList& pieces = st.pieces;
+    const int victim_val = piece_value_fast(pieces[(size_t)ti].kind);
+    if (victim_val < threshold) return false;
+    if (victim_val - piece_value_fast(pieces[(size_t)ai].kind) >= threshold) return true;
+
+    const int sq = sq_index(m.dc, m.dr);
+    BB132 target;
+    target.set(sq);
+    MoveGenContext ctx = base;
+    // Pieces already traded off the board, or riding along onto the target
+    // square with their carrier.
+    std::vector<uint8_t> gone(pieces.size(), 0);
+    auto take_off = [&](int idx) {
+        gone[(size_t)idx] = 1;
+        for (size_t i = 0; i < pieces.size(); i++)
+            if (pieces[i].carrier_id == pieces[(size_t)idx].id) gone[i] = 1;
+    };
+    take_off(ti);
+    auto aa_radius = [](PieceKind k) {
+        if (k == PieceKind::AntiAircraft || k == PieceKind::Navy) return 1;
+        return k == PieceKind::Missile ? 2 : 0;
+    };
+    // AA cover moves with the pieces that provide it; rebuilt only when a
+    // covering piece is taken or lands on the square.
+    auto refresh_aa_cover = [&](int occupant) {
+        ctx.aa_cover_by_player[0].clear();
+        ctx.aa_cover_by_player[1].clear();
+        for (size_t i = 0; i < pieces.size(); i++) {
+            const Piece& p = pieces[i];
+            const bool here = (int)i == occupant;
+            if (gone[i] && !here) continue;
+            int radius = aa_radius(p.kind);
+            if (radius == 0) continue;
+            int pc = here ? m.dc : p.col, pr = here ? m.dr : p.row;
+            for (int dc = -radius; dc <= radius; dc++)
+                for (int dr = -radius; dr <= radius; dr++)
+                    if (on_board(pc + dc, pr + dr))
+                        ctx.aa_cover_by_player[player_idx(p.player)].set(sq_index(pc + dc, pr + dr));
+        }
+    };
+    auto aa_covers = [&](Player enemy) {
+        for (size_t i = 0; i < pieces.size(); i++) {
+            const Piece& p = pieces[i];
+            if (p.player != enemy || gone[i]) continue;
+            int d = std::max(std::abs(p.col - m.dc), std::abs(p.row - m.dr));
+            if (d <= aa_radius(p.kind)) return true;
+        }
+        return false;
+    };
+
+    int gain[32];
+    int d = 0;
+    gain[0] = victim_val;
+    int cur = ai;
+    PieceKind taken = pieces[(size_t)ti].kind;
+    while (d < 31) {
+        const Piece& c = pieces[(size_t)cur];
+        const Player side = opp(c.player);
+        if (c.kind == PieceKind::AirForce && !c.hero && aa_covers(side)) {
+            d++;
+            gain[d] = piece_value_fast(c.kind) - gain[d - 1];
+            break;
+        }
+        if ((c.kind == PieceKind::Navy && !is_navigable(m.dc, m.dr)) ||
+            (c.kind == PieceKind::Tank && is_sea(m.dc, m.dr))) break;
+
+        // Move the capturer (and its cargo) onto the square, then look for
+        // the reply. A carried capturer leaves its carrier behind.
+        const int csq = sq_index(c.col, c.row);
+        const int cpl = player_idx(c.player);
+        take_off(cur);
+        if (c.carrier_id < 0) {
+            ctx.occ_all.reset(csq);
+            ctx.occ_by_player[cpl].reset(csq);
+            ctx.sq_to_piece[(size_t)csq] = -1;
+        }
+        ctx.occ_by_player[1 - cpl].reset(sq);
+        ctx.occ_by_player[cpl].set(sq);
+        ctx.sq_to_piece[(size_t)sq] = cur;
+        if (c.kind == PieceKind::Commander) ctx.commander_sq[cpl] = sq;
+        if (aa_radius(c.kind) || aa_radius(taken)) refresh_aa_cover(cur);
+
+        int lva = -1, lva_val = 0;
+        for (int i = 0; i < (int)pieces.size(); i++) {
+            const Piece& p = pieces[(size_t)i];
+            if (p.player != side || gone[(size_t)i] || !on_board(p.col, p.row)) continue;
+            int v = std::max(1, piece_value_fast(p.kind));
+            if (lva >= 0 && v >= lva_val) continue;
+            if (get_targeted_mask_bitboard(p, ctx, target).any()) { lva = i; lva_val = v; }
+        }
+        if (lva < 0) break;
+        // Bombardment return-to-base: the Air Force flies home from a
+        // defended land target, leaving nothing to recapture.
+        if (c.kind == PieceKind::AirForce && taken != PieceKind::Navy &&
+            taken != PieceKind::AirForce) break;
+
+        d++;
+        gain[d] = piece_value_fast(c.kind) - gain[d - 1];
+        if (std::max(-gain[d - 1], gain[d]) < 0) break;
+        taken = c.kind;
+        cur = lva;
+    }
+    for (; d > 0; d--) gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    return gain[0] >= threshold;
+}
+
 // ── Move ordering ──────────────────────────────────────────────────────────
 static int score_move_for_order(const MoveTriple& m,
                                 const PieceList& pieces,
@@ -3184,45 +3944,173 @@ static int score_move_for_order(const MoveTriple& m,
         int ki = kind_index(piece->kind);
         score = td ? td_history_score(*td, hist_pl, ki, m.dc, m.dr)
                    : history_score(hist_pl, ki, m.dc, m.dr);
-        score += td ? td_cont_history_score(*td, prev_move, ki, m.dc, m.dr)
-                    : cont_history_score(prev_move, ki, m.dc, m.dr);
+        score += td ? td_cont_history_score(*td, prev_move, ply, ki, m.dc, m.dr)
+                    : cont_history_score(prev_move, ply, ki, m.dc, m.dr);
     }
     return score;
 }
 
+// Staged move picker for alphabeta(). The hash move and PV move are tried
+// before anything is generated, and the countermove and killers right after
+// the captures; each of these is validated on its own with
+// move_is_pseudo_legal(), so a cutoff on one of them skips the quiet moves
+// (or, for the hash/PV move, the whole generation pass). The resulting order
+// matches score_move_for_order(): hash, PV, captures by SEE, countermove,
+// killers, then quiets by history.
 struct MovePicker {
     struct ScoredMove {
         int score = -1000000;
         MoveTriple move{};
     };
+    enum Stage { STAGE_HASH, STAGE_PV, STAGE_GEN_CAPTURES, STAGE_CAPTURES,
+                 STAGE_COUNTER, STAGE_KILLER1, STAGE_KILLER2,
+                 STAGE_GEN_QUIETS, STAGE_QUIETS, STAGE_DONE };
+
+    const SearchState& st;
+    int ply;
+    const MoveTriple* hash_move;   // already validated by the caller
+    const MoveTriple* pv_move;
+    const MoveTriple* prev_move;
+    const MoveTriple* counter_move = nullptr;
+    ThreadData* td;
+    int hist_pl;
+    int stage = STAGE_HASH;
+
+    // Moves already handed out by a single-move stage; skipped when generated.
+    MoveTriple tried[5];
+    int n_tried = 0;
 
+    MoveGenContext ctx;
+    std::vector<std::pair<int, BB132>> masks;   // (piece id, full destination mask)
     std::vector<ScoredMove> scored;
     std::size_t next_idx = 0;
-
-    MovePicker(const AllMoves& moves, const PieceList& pieces,
-               Player player, int ply,
-               const MoveTriple* hash_move,
-               const MoveTriple* pv_move,
-               const MoveTriple* prev_move,
-               ThreadData* td) {
-        scored.reserve(moves.size());
-        const MoveTriple* counter_move = nullptr;
+    AllMoves all;
+    bool all_ready = false;
+
+    MovePicker(const SearchState& st_, int ply_,
+               const MoveTriple* hash_move_,
+               const MoveTriple* pv_move_,
+               const MoveTriple* prev_move_,
+               ThreadData* td_)
+        : st(st_), ply(ply_), hash_move(hash_move_), pv_move(pv_move_),
+          prev_move(prev_move_), td(td_) {
         if (prev_move && on_board(prev_move->dc, prev_move->dr)) {
             bool cs = td ? td->counter_set[prev_move->dc][prev_move->dr]
                          : g_counter_set[prev_move->dc][prev_move->dr];
             if (cs) counter_move = td ? &td->counter[prev_move->dc][prev_move->dr]
                                       : &g_counter[prev_move->dc][prev_move->dr];
         }
-        int hist_pl = player_idx(player);
+        hist_pl = player_idx(st.turn);
         if (hist_pl < 0) hist_pl = 0;
-        for (const auto& m : moves) {
-            int sc = score_move_for_order(m, pieces, player, ply, hash_move, pv_move,
-                                          prev_move, counter_move, hist_pl, td);
+    }
+
+    // The full move list, for the few callers (singular extension) that need
+    // every alternative. Generated on first use.
+    const AllMoves& all_moves() {
+        if (!all_ready) { all = all_moves_for(st.pieces, st.turn); all_ready = true; }
+        return all;
+    }
+
+    bool next(MoveTriple& out) {
+        while (true) {
+            switch (stage) {
+            case STAGE_HASH:
+                stage = STAGE_PV;
+                if (hash_move && take(*hash_move, out)) return true;
+                break;
+            case STAGE_PV:
+                stage = STAGE_GEN_CAPTURES;
+                if (pv_move && move_is_pseudo_legal(st, *pv_move) && take(*pv_move, out)) return true;
+                break;
+            case STAGE_GEN_CAPTURES: {
+                ctx = build_movegen_context(st.pieces);
+                const BB132& enemy = ctx.occ_by_player[1 - hist_pl];
+                masks.reserve(st.pieces.size());
+                for (const auto& p : st.pieces) {
+                    if (p.player != st.turn) continue;
+                    BB132 bb = get_move_mask_bitboard(p, ctx);
+                    if (!bb.any()) continue;
+                    masks.push_back({p.id, bb});
+                    bb.and_bits(enemy);
+                    push_scored(p.id, bb);
+                }
+                stage = STAGE_CAPTURES;
+                break;
+            }
+            case STAGE_CAPTURES:
+                if (pick_best(out)) return true;
+                stage = STAGE_COUNTER;
+                break;
+            case STAGE_COUNTER:
+                stage = STAGE_KILLER1;
+                if (counter_move && quiet_is_valid(*counter_move) && take(*counter_move, out)) return true;
+                break;
+            case STAGE_KILLER1:
+            case STAGE_KILLER2: {
+                int k = stage - STAGE_KILLER1;
+                stage++;
+                bool set = ply < MAX_PLY && (td ? td->killers_set[ply][k] : g_killers_set[ply][k]);
+                if (!set) break;
+                const MoveTriple& km = td ? td->killers[ply][k] : g_killers[ply][k];
+                if (quiet_is_valid(km) && take(km, out)) return true;
+                break;
+            }
+            case STAGE_GEN_QUIETS: {
+                const BB132& enemy = ctx.occ_by_player[1 - hist_pl];
+                scored.clear();
+                next_idx = 0;
+                for (auto& pm : masks) {
+                    BB132 bb = pm.second;
+                    bb.and_not_bits(enemy);
+                    push_scored(pm.first, bb);
+                }
+                stage = STAGE_QUIETS;
+                break;
+            }
+            case STAGE_QUIETS:
+                if (pick_best(out)) return true;
+                stage = STAGE_DONE;
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+private:
+    bool already_tried(const MoveTriple& m) const {
+        for (int i = 0; i < n_tried; i++) if (same_move(tried[i], m)) return true;
+        return false;
+    }
+
+    bool take(const MoveTriple& m, MoveTriple& out) {
+        if (already_tried(m)) return false;
+        tried[n_tried++] = m;
+        out = m;
+        return true;
+    }
+
+    // A countermove/killer is only tried here if it is still a quiet move;
+    // as a capture it has already come out of the capture stage.
+    bool quiet_is_valid(const MoveTriple& m) const {
+        if (!move_is_pseudo_legal(st, m)) return false;
+        int ti = find_piece_idx_at_fast(st, m.dc, m.dr);
+        return ti < 0 || st.pieces[(std::size_t)ti].player == st.turn;
+    }
+
+    void push_scored(int pid, BB132 bb) {
+        while (true) {
+            int sq = bb_pop_lsb(bb);
+            if (sq < 0) break;
+            MoveTriple m{pid, sq_col(sq), sq_row(sq)};
+            if (already_tried(m)) continue;
+            int sc = score_move_for_order(m, st.pieces, st.turn, ply, nullptr, nullptr,
+                                          prev_move, nullptr, hist_pl, td);
             scored.push_back({sc, m});
         }
     }
 
-    bool next(MoveTriple& out) {
+    bool pick_best(MoveTriple& out) {
         if (next_idx >= scored.size()) return false;
         std::size_t best = next_idx;
         for (std::size_t i = next_idx + 1; i < scored.size(); i++) {
@@ -3334,20 +4222,44 @@ static ObjectiveCounts collect_objective_counts(const PieceList& pieces, Player
     return out;
 }
 
-static bool side_fulfills_win_objective(const ObjectiveCounts& self,
-                                        const ObjectiveCounts& enemy) {
+template <GameMode M>
+static bool side_fulfills_win_objective_t(const ObjectiveCounts& self,
+                                          const ObjectiveCounts& enemy) {
     (void)self;
-    switch (g_game_mode) {
-    case GameMode::MARINE_BATTLE:
-        return enemy.commander == 0 || enemy.navy == 0;
-    case GameMode::AIR_BATTLE:
-        return enemy.commander == 0 || enemy.air_force == 0;
-    case GameMode::LAND_BATTLE:
-        return enemy.commander == 0 ||
-               (enemy.tank == 0 && enemy.infantry == 0 && enemy.artillery == 0);
-    case GameMode::FULL_BATTLE:
-    default:
-        return enemy.commander == 0;
+    if (enemy.commander == 0) return true;
+    if constexpr (M == GameMode::MARINE_BATTLE) return enemy.navy == 0;
+    else if constexpr (M == GameMode::AIR_BATTLE) return enemy.air_force == 0;
+    else if constexpr (M == GameMode::LAND_BATTLE)
+        return enemy.tank == 0 && enemy.infantry == 0 && enemy.artillery == 0;
+    else return false;
+}
+
+// Variant-only eval term: the last objective units are worth far more than
+// their material value, and an attacked one is a near-decisive threat.
+// Score is from `perspective`; zero in Full Battle.
+template <GameMode M>
+static int objective_eval_t(SearchState& st, Player perspective) {
+    if constexpr (M == GameMode::FULL_BATTLE) {
+        (void)st; (void)perspective;
+        return 0;
+    } else {
+        ensure_attack_cache(st);
+        int left[2] = {0, 0}, hanging[2] = {0, 0};
+        for (const auto& p : st.pieces) {
+            if (!is_objective_kind<M>(p.kind) || !on_board(p.col, p.row)) continue;
+            int pl = player_idx(p.player);
+            left[pl]++;
+            if (st.atk.counts[1 - pl][p.row][p.col] > 0) hanging[pl]++;
+        }
+        auto side_term = [&](int pl) {
+            int t = 0;
+            if (left[pl] == 1) t -= 260;
+            else if (left[pl] == 2) t -= 80;
+            if (left[pl] <= 2) t -= 140 * hanging[pl];
+            return t;
+        };
+        int me = player_idx(perspective);
+        return side_term(me) - side_term(1 - me);
     }
 }
 
@@ -3357,6 +4269,7 @@ static bool side_fulfills_win_objective(const ObjectiveCounts& self,
 //  • objective-complete decisive states (variant-specific)
 //  • practical fortress/no-progress draws
 //  • carrier-stacking loop-like dead-draw signatures
+template <GameMode M>
 static bool low_depth_special_outcome(SearchState& st, Player perspective,
                                       int depth_hint, int* out_score) {
     if (!out_score || depth_hint > 3) return false;
@@ -3366,8 +4279,8 @@ static bool low_depth_special_outcome(SearchState& st, Player perspective,
     ObjectiveCounts them = collect_objective_counts(st.pieces, enemy);
 
     // Objective-based decisive recognizer (independent of "last mover").
-    bool me_wins = side_fulfills_win_objective(me, them);
-    bool them_wins = side_fulfills_win_objective(them, me);
+    bool me_wins = side_fulfills_win_objective_t<M>(me, them);
+    bool them_wins = side_fulfills_win_objective_t<M>(them, me);
     if (me_wins || them_wins) {
         if (me_wins && them_wins) {
             *out_score = 0;
@@ -3440,8 +4353,8 @@ static bool low_depth_special_outcome(SearchState& st, Player perspective,
     bool carrier_loop_signature = (me.carried_units + them.carried_units >= 4);
 
     if (no_captures && low_mobility && (no_progress || carrier_loop_signature)) {
-        if (!has_immediate_winning_move(st.pieces, perspective) &&
-            !has_immediate_winning_move(st.pieces, enemy)) {
+        if (!has_immediate_winning_move_t<M>(st.pieces, perspective) &&
+            !has_immediate_winning_move_t<M>(st.pieces, enemy)) {
             *out_score = 0;
             return true;
         }
@@ -3978,23 +4891,32 @@ static int board_score(const PieceList& pieces, Player perspective,
 
 // ── Quiescence ────────────────────────────────────────────────────────────
 static std::atomic<uint64_t> g_nodes{0};  // global node counter for NPS / time mgmt
+static thread_local uint64_t g_thread_nodes = 0; // per-thread count (root move effort)
+static std::atomic<uint64_t> g_search_node_limit{0}; // node budget per search (--suite), 0 = none
+
+static inline bool node_limit_reached() {
+    const uint64_t limit = g_search_node_limit.load(std::memory_order_relaxed);
+    return limit != 0 && g_nodes.load(std::memory_order_relaxed) >= limit;
+}
 static const int Q_LIMIT   = 6;   // raised from 4 for deeper tactical vision
 static const int DELTA_MARGIN = 200; // delta pruning margin
 
-static int quiesce(SearchState& st, int alpha, int beta,
-                   Player perspective, Player cpu_player,
-                   int q_depth=0) {
+template <GameMode M>
+static int quiesce_t(SearchState& st, int alpha, int beta,
+                     Player perspective, Player cpu_player,
+                     int q_depth, ThreadData* td) {
     g_nodes.fetch_add(1, std::memory_order_relaxed);
+    g_thread_nodes++;
     int stand = (perspective == cpu_player) ? st.quick_eval : -st.quick_eval;
     if (q_depth == 0) {
         ensure_attack_cache(st);
         int precise = board_score(st.pieces, perspective, &st.atk, &perspective, &st);
-        stand = (stand * 2 + precise) / 3;
+        stand = (stand * 2 + precise) / 3 + objective_eval_t<M>(st, perspective);
     }
 
     if (q_depth <= 3) {
         int special_score = 0;
-        if (low_depth_special_outcome(st, perspective, 3 - q_depth, &special_score))
+        if (low_depth_special_outcome<M>(st, perspective, 3 - q_depth, &special_score))
             return special_score;
     }
 
@@ -4015,8 +4937,33 @@ static int quiesce(SearchState& st, int alpha, int beta,
         }
     }
 
+    // ── TT probe ──────────────────────────────────────────────────────────
+    // Entries are stored from cpu_player's perspective (same as alphabeta);
+    // flip value and bound direction when the side to move is the opponent.
+    // Q-entries use depth -q_depth, so any main-search entry also qualifies.
+    const bool flip = (perspective != cpu_player);
+    const int tt_depth = -q_depth;
+    const int orig_alpha = alpha;
+    MoveTriple tt_move{-1, -1, -1};
+    if (const TTDecoded* tte = tt_probe(st.hash, td)) {
+        if (tte->depth >= tt_depth) {
+            int v = flip ? -tte->val : tte->val;
+            int f = tte->flag;
+            if (flip && f != TT_EXACT) f = (f == TT_LOWER) ? TT_UPPER : TT_LOWER;
+            if (f == TT_EXACT) return v;
+            if (f == TT_LOWER && v >= beta) return v;
+            if (f == TT_UPPER && v <= alpha) return v;
+        }
+        tt_move = tt_unpack_move(*tte);
+    }
+    auto qs_store = [&](int v, int bound, const MoveTriple& best) {
+        int f = bound;
+        if (flip && f != TT_EXACT) f = (f == TT_LOWER) ? TT_UPPER : TT_LOWER;
+        tt_store_qs(st.hash, tt_depth, f, flip ? -v : v, best);
+    };
+
     if (!in_check) {
-        if (stand >= beta) return beta;
+        if (stand >= beta) { qs_store(beta, TT_LOWER, tt_move); return beta; }
         // Delta pruning: skip positions where even the best capture can't improve alpha
         if (stand < alpha - DELTA_MARGIN - 800) return alpha;
         if (alpha < stand) alpha = stand;
@@ -4028,30 +4975,27 @@ static int quiesce(SearchState& st, int alpha, int beta,
     CapMove caps[128];  // enough for captures + commander evasions
     int ncaps = 0;
     MoveGenContext qctx = build_movegen_context(st.pieces);
-    for (auto& p : st.pieces) {
-        if (p.player != perspective) continue;
-        BB132 bb = get_move_mask_bitboard(p, qctx);
-        for (int c = 0; c < COLS; c++) {
-            for (int r = 0; r < ROWS; r++) {
-                int sq = sq_index(c, r);
-                if (!bb.test(sq)) continue;
-                int ti = qctx.sq_to_piece[(std::size_t)sq];
-                const Piece* t = (ti >= 0) ? &st.pieces[(std::size_t)ti] : nullptr;
-            bool is_cap = (t && t->player != perspective);
-            // In check: also include quiet commander moves as evasions
-            bool is_evasion = (in_check && p.kind == PieceKind::Commander && !is_cap);
-            if (!is_cap && !is_evasion) continue;
-                int sv = is_cap ? see(st.pieces, c, r, perspective) : 0;
-                if (ncaps < 128) caps[ncaps++] = {p.id, c, r, sv, !is_cap};
-            }
-        }
+    for_each_capture(st.pieces, qctx, perspective, [&](const Piece& p, int sq) {
+        int c = sq_col(sq), r = sq_row(sq);
+        int sv = see(st.pieces, c, r, perspective);
+        if (ncaps < 128) caps[ncaps++] = {p.id, c, r, sv, false};
+    });
+    // In check: also include quiet commander moves as evasions
+    if (in_check) {
+        for_each_commander_evasion(st.pieces, qctx, perspective, [&](const Piece& p, int sq) {
+            if (ncaps < 128) caps[ncaps++] = {p.id, sq_col(sq), sq_row(sq), 0, true};
+        });
     }
     // Insertion sort (fast for small N, no allocations): captures first by SEE, then evasions
     for (int i = 1; i < ncaps; i++) {
         CapMove key = caps[i];
         int j = i - 1;
         // Sort: non-quiet (captures) ranked by SEE descending; quiet evasions last
-        auto rank = [](const CapMove& c) { return c.is_quiet ? -100000 : c.see_val; };
+        // The TT's best capture (if still generated here) is tried first.
+        auto rank = [&](const CapMove& c) {
+            if (c.pid == tt_move.pid && c.dc == tt_move.dc && c.dr == tt_move.dr) return 1000000;
+            return c.is_quiet ? -100000 : c.see_val;
+        };
         while (j >= 0 && rank(caps[j]) < rank(key)) {
             caps[j+1] = caps[j];
             j--;
@@ -4059,6 +5003,7 @@ static int quiesce(SearchState& st, int alpha, int beta,
         caps[j+1] = key;
     }
 
+    MoveTriple best_cap = tt_move;
     for (int ci = 0; ci < ncaps; ci++) {
         auto& c = caps[ci];
         // For quiet evasions (in-check only): no SEE or delta pruning
@@ -4070,42 +5015,645 @@ static int quiesce(SearchState& st, int alpha, int beta,
         }
         UndoMove u;
         if (!make_move_inplace_search(st, {c.pid, c.dc, c.dr}, cpu_player, u)) continue;
-        int s = -quiesce(st, -beta, -alpha, opp(perspective), cpu_player, q_depth+1);
+        int s = -quiesce_t<M>(st, -beta, -alpha, opp(perspective), cpu_player, q_depth+1, td);
         unmake_move_inplace(st, u);
-        if (s >= beta) return beta;
-        if (s > alpha) alpha = s;
+        if (s >= beta) { qs_store(beta, TT_LOWER, {c.pid, c.dc, c.dr}); return beta; }
+        if (s > alpha) { alpha = s; best_cap = {c.pid, c.dc, c.dr}; }
     }
+    qs_store(alpha, alpha > orig_alpha ? TT_EXACT : TT_UPPER, best_cap);
     return alpha;
 }
 
-// ── LMR Reduction Table (logarithmic) ────────────────────────────────────
-static int g_lmr_table[64][64];
-static bool g_lmr_init = false;
+// ── Read-only data files ──────────────────────────────────────────────────
+// Zero-copy view of a data file (tablebases, opening book): mmap where
+// available, otherwise the bytes are read into memory once.
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    std::vector<uint8_t> owned;
+#if COMMANDER_HAS_MMAP
+    void* map_base = nullptr;
+#endif
 
-static void init_lmr_table() {
-    if (g_lmr_init) return;
-    // Stockfish 18 LMR formula: reduction ≈ ln(depth) * ln(moves) / 2.0
-    // (slightly more aggressive than the old /2.25; improves search speed
-    //  at depth ≥ 6 where later moves are almost always sub-optimal)
-    for (int d = 0; d < 64; d++) {
-        for (int m = 0; m < 64; m++) {
-            if (d == 0 || m == 0) { g_lmr_table[d][m] = 0; continue; }
-            g_lmr_table[d][m] = (int)(0.50 + std::log(d) * std::log(m) / 2.0);
-            if (g_lmr_table[d][m] < 0) g_lmr_table[d][m] = 0;
-        }
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() {
+#if COMMANDER_HAS_MMAP
+        if (map_base) munmap(map_base, size);
+#endif
     }
-    g_lmr_init = true;
+
+    bool open(const std::string& path) {
+#if COMMANDER_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat sb{};
+        if (fstat(fd, &sb) != 0 || sb.st_size <= 0) { close(fd); return false; }
+        void* base = mmap(nullptr, (std::size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) return false;
+        map_base = base;
+        data = static_cast<const uint8_t*>(base);
+        size = (std::size_t)sb.st_size;
+        return true;
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (bytes.empty()) return false;
+        adopt(std::move(bytes));
+        return true;
+#endif
+    }
+
+    // Takes ownership of an in-memory image (WASM hosts hand files over this way).
+    void adopt(std::vector<uint8_t>&& bytes) {
+        owned = std::move(bytes);
+        data = owned.data();
+        size = owned.size();
+    }
+};
+
+// ── Endgame tablebases (Full Battle) ──────────────────────────────────────
+// Retrograde-solved endgames with both Commanders, any Headquarters still on
+// their home squares, and up to TB_MAX_UNITS other units. One file per
+// material signature ("CTh3vCh1.cctb"), memory-mapped on first probe.
+// Each entry is one byte from the side to move's point of view:
+//   0 = draw, 1..126 = win in 2v-1 plies, 129..254 = loss in 2(v-128) plies,
+//   255 = not covered (unreachable position or unresolved dependency).
+// Plies count until the enemy Commander is captured. Tables are built by
+// `--tb-gen DIR`; absent files simply make probes miss.
+static const int TB_MAX_UNITS = 3;        // non-Commander, non-HQ units (both sides)
+static const int TB_MAX_PLIES = 251;
+static const uint8_t TB_NONE = 255;
+static const int TB_WIN_SCORE = 38000;    // below real captures (40000+) in alphabeta
+static const char TB_MAGIC[8] = {'C', 'C', 'T', 'B', 'v', '0', '0', '1'};
+static const int TB_HQ_HOME[2][2][2] = {{{5, 1}, {7, 1}}, {{5, 10}, {7, 10}}}; // [side][slot]{col,row}
+
+enum class TBWdl : int8_t { None = -2, Loss = -1, Draw = 0, Win = 1 };
+
+struct TBProbe {
+    TBWdl wdl = TBWdl::None;
+    int plies = 0; // plies until the Commander falls (Win/Loss only)
+};
+
+static inline uint8_t tb_encode_value(TBWdl wdl, int plies) {
+    if (wdl == TBWdl::Win) return (uint8_t)((plies + 1) / 2);
+    if (wdl == TBWdl::Loss) return (uint8_t)(128 + plies / 2);
+    return 0;
 }
 
-static int lmr_reduction(int depth, int move_index) {
-    int d = std::min(depth, 63);
-    int m = std::min(move_index, 63);
-    return g_lmr_table[d][m];
+static inline TBProbe tb_decode_value(uint8_t v) {
+    TBProbe r;
+    if (v == TB_NONE) return r;
+    if (v == 0) r.wdl = TBWdl::Draw;
+    else if (v < 128) { r.wdl = TBWdl::Win; r.plies = 2 * v - 1; }
+    else { r.wdl = TBWdl::Loss; r.plies = 2 * (v - 128); }
+    return r;
 }
 
-// ── Alpha-Beta with PVS + LMR + NMP + SEE Pruning + Improving ───────────
-static thread_local std::chrono::steady_clock::time_point g_deadline;
-static thread_local const std::atomic<bool>* g_stop_flag = nullptr;
+// Material signature. HQs never move (a non-hero HQ has no moves and cannot
+// become heroic), so they live in the signature as home-square masks rather
+// than in the index.
+struct TBMaterial {
+    uint8_t hq_mask[2] = {0, 0};
+    std::array<PieceKind, TB_MAX_UNITS> units[2]{};
+    int n_units[2] = {0, 0};
+
+    // Packed identity: 2 HQ bits + 2 count bits + 3 x 4 kind bits per side.
+    uint64_t key() const {
+        uint64_t k = 0;
+        for (int side = 0; side < 2; side++) {
+            k = (k << 4) | (uint64_t)(hq_mask[side] | (n_units[side] << 2));
+            for (int i = 0; i < TB_MAX_UNITS; i++)
+                k = (k << 4) | (uint64_t)(i < n_units[side] ? (int)units[side][(std::size_t)i] : 0);
+        }
+        return k;
+    }
+
+    bool operator==(const TBMaterial& o) const { return key() == o.key(); }
+
+    std::string name() const {
+        std::string s;
+        for (int side = 0; side < 2; side++) {
+            if (side) s += 'v';
+            s += 'C';
+            for (int i = 0; i < n_units[side]; i++) s += kind_to_string(units[side][(std::size_t)i]);
+            if (hq_mask[side]) s += 'h' + std::to_string((int)hq_mask[side]);
+        }
+        return s;
+    }
+};
+
+struct TBSlot {
+    Player player;
+    PieceKind kind;
+    int domain;       // 264 = square*2 + hero, 132 = square (hero forced)
+    bool forced_hero; // last remaining unit of its side (last-protector rule)
+};
+
+struct TBTable {
+    TBMaterial mat;
+    std::vector<TBSlot> slots;
+    uint64_t entries = 0;
+    int max_plies = 0;
+    const uint8_t* data = nullptr;
+    MappedFile file;            // probed tables
+    std::vector<uint8_t> owned; // generator output
+};
+
+struct TBFileHeader {
+    char magic[8];
+    uint64_t entries;
+    uint32_t max_plies;
+    uint32_t reserved;
+    char name[40];
+};
+static_assert(sizeof(TBFileHeader) == 64, "tablebase header must stay 64 bytes");
+
+static void tb_build_slots(TBTable& t) {
+    t.slots.clear();
+    t.slots.push_back({Player::Red, PieceKind::Commander, COLS * ROWS * 2, false});
+    t.slots.push_back({Player::Blue, PieceKind::Commander, COLS * ROWS * 2, false});
+    for (int side = 0; side < 2; side++) {
+        Player pl = side ? Player::Blue : Player::Red;
+        bool forced = (t.mat.n_units[side] == 1);
+        for (int i = 0; i < t.mat.n_units[side]; i++)
+            t.slots.push_back({pl, t.mat.units[side][(std::size_t)i], forced ? COLS * ROWS : COLS * ROWS * 2, forced});
+    }
+    t.entries = 2;
+    for (const auto& s : t.slots) t.entries *= (uint64_t)s.domain;
+}
+
+// Reads the material signature of `pieces`; false if it is not tablebase material.
+static bool tb_material_of(const PieceList& pieces, TBMaterial& mat) {
+    mat = TBMaterial{};
+    int commanders[2] = {0, 0};
+    for (const auto& p : pieces) {
+        if (!on_board(p.col, p.row)) continue;
+        int side = player_idx(p.player);
+        if (p.kind == PieceKind::Commander) { commanders[side]++; continue; }
+        if (p.kind == PieceKind::HQ) {
+            int slot = -1;
+            for (int i = 0; i < 2; i++)
+                if (p.col == TB_HQ_HOME[side][i][0] && p.row == TB_HQ_HOME[side][i][1]) slot = i;
+            if (slot < 0 || p.hero || (mat.hq_mask[side] & (1 << slot))) return false;
+            mat.hq_mask[side] |= (uint8_t)(1 << slot);
+            continue;
+        }
+        if (mat.n_units[0] + mat.n_units[1] >= TB_MAX_UNITS) return false;
+        mat.units[side][(std::size_t)mat.n_units[side]++] = p.kind;
+    }
+    if (commanders[0] != 1 || commanders[1] != 1) return false;
+    for (int side = 0; side < 2; side++)
+        std::sort(mat.units[side].begin(), mat.units[side].begin() + mat.n_units[side]);
+    return true;
+}
+
+// Index -> position. Pieces get ids 0..slots-1 (then the HQs). Friendly pieces
+// sharing a square form one stack whose carrier is the member able to carry
+// all the others. With `validate`, positions no legal move can produce are
+// rejected: enemies sharing a square, units on Commander-only squares, bad
+// stacks, and non-heroes currently attacking the enemy Commander (every move
+// ends with promote_heroes_from_checks()).
+static bool tb_decode(const TBTable& t, uint64_t idx, PieceList& out, Player& stm, bool validate) {
+    out.clear();
+    stm = (idx & 1) ? Player::Blue : Player::Red;
+    idx >>= 1;
+    for (int i = 0; i < (int)t.slots.size(); i++) {
+        const TBSlot& s = t.slots[(std::size_t)i];
+        int v = (int)(idx % (uint64_t)s.domain);
+        idx /= (uint64_t)s.domain;
+        int sq = s.forced_hero ? v : (v >> 1);
+        bool hero = s.forced_hero || (v & 1);
+        out.push_back({(int16_t)i, s.player, s.kind, (int8_t)sq_col(sq), (int8_t)sq_row(sq), hero, -1});
+    }
+    const int n_slots = (int)out.size();
+    for (int side = 0; side < 2; side++)
+        for (int i = 0; i < 2; i++)
+            if (t.mat.hq_mask[side] & (1 << i))
+                out.push_back({(int16_t)out.size(), side ? Player::Blue : Player::Red, PieceKind::HQ,
+                               (int8_t)TB_HQ_HOME[side][i][0], (int8_t)TB_HQ_HOME[side][i][1], false, -1});
+
+    for (int i = 0; i < (int)out.size(); i++) {
+        Piece& p = out[(std::size_t)i];
+        if (validate && p.kind != PieceKind::Commander && p.kind != PieceKind::HQ && is_hq_square(p.col, p.row))
+            return false;
+        // First piece of each square builds that square's stack.
+        bool first = true;
+        for (int j = 0; j < i; j++)
+            if (out[(std::size_t)j].col == p.col && out[(std::size_t)j].row == p.row) { first = false; break; }
+        if (!first) continue;
+        int members[8], n = 0;
+        for (int j = i; j < (int)out.size() && n < 8; j++)
+            if (out[(std::size_t)j].col == p.col && out[(std::size_t)j].row == p.row) members[n++] = j;
+        if (n == 1) continue;
+        int root = -1;
+        for (int a = 0; a < n && root < 0; a++) {
+            const Piece& c = out[(std::size_t)members[a]];
+            bool carries_all = true;
+            for (int b = 0; b < n && carries_all; b++)
+                if (b != a && (out[(std::size_t)members[b]].player != c.player ||
+                               !can_carry_kind(c.kind, out[(std::size_t)members[b]].kind)))
+                    carries_all = false;
+            if (carries_all) root = members[a];
+        }
+        if (root < 0) return false;
+        for (int a = 0; a < n; a++)
+            if (members[a] != root) out[(std::size_t)members[a]].carrier_id = (int8_t)out[(std::size_t)root].id;
+        if (validate && !carrier_capacity_valid(out, out[(std::size_t)root].id, out[(std::size_t)root].kind))
+            return false;
+    }
+    if (validate) {
+        PieceList promoted = out;
+        promote_heroes_from_checks(promoted);
+        for (int i = 0; i < n_slots; i++)
+            if (promoted[(std::size_t)i].hero != out[(std::size_t)i].hero) return false;
+    }
+    return true;
+}
+
+// Position -> index. Fails when the stack structure differs from the one
+// tb_decode() would rebuild (e.g. nested carriers) or a forced hero is not.
+static bool tb_encode(const TBTable& t, const PieceList& pieces, Player stm, uint64_t& idx) {
+    std::array<int, 2 + TB_MAX_UNITS> slot_piece{};
+    slot_piece.fill(-1);
+    for (int i = 0; i < (int)pieces.size(); i++) {
+        const Piece& p = pieces[(std::size_t)i];
+        if (!on_board(p.col, p.row) || p.kind == PieceKind::HQ) continue;
+        bool placed = false;
+        for (int s = 0; s < (int)t.slots.size() && !placed; s++) {
+            if (slot_piece[(std::size_t)s] >= 0) continue;
+            if (t.slots[(std::size_t)s].player != p.player || t.slots[(std::size_t)s].kind != p.kind) continue;
+            slot_piece[(std::size_t)s] = i;
+            placed = true;
+        }
+        if (!placed) return false;
+    }
+    uint64_t v = 0;
+    for (int s = (int)t.slots.size() - 1; s >= 0; s--) {
+        const TBSlot& slot = t.slots[(std::size_t)s];
+        if (slot_piece[(std::size_t)s] < 0) return false;
+        const Piece& p = pieces[(std::size_t)slot_piece[(std::size_t)s]];
+        if (slot.forced_hero && !p.hero) return false;
+        int sq = sq_index(p.col, p.row);
+        v = v * (uint64_t)slot.domain + (uint64_t)(slot.forced_hero ? sq : sq * 2 + (p.hero ? 1 : 0));
+    }
+    idx = v * 2 + (stm == Player::Blue ? 1 : 0);
+
+    // Carrier links must match the canonical stacks.
+    PieceList canon;
+    Player canon_stm;
+    tb_decode(t, idx, canon, canon_stm, false);
+    for (int s = 0; s < (int)t.slots.size(); s++) {
+        const Piece& p = pieces[(std::size_t)slot_piece[(std::size_t)s]];
+        int carrier_slot = -1;
+        if (p.carrier_id >= 0) {
+            for (int c = 0; c < (int)t.slots.size(); c++)
+                if (pieces[(std::size_t)slot_piece[(std::size_t)c]].id == p.carrier_id) carrier_slot = c;
+            if (carrier_slot < 0) return false;
+        }
+        if (canon[(std::size_t)s].carrier_id != carrier_slot) return false;
+    }
+    return true;
+}
+
+// ── Table registry ──
+// Probes never lock. Each material signature seen gets one slot in a fixed
+// open-addressed table; its table pointer (a loaded table, or the "missing"
+// sentinel) is written once and then published by a release store of the
+// key. Only the first probe of a signature takes g_tb_mutex to open the file.
+static const int TB_REG_SIZE = 1 << 15;             // > every signature up to TB_MAX_UNITS
+static const uint64_t TB_REG_USED = 1ULL << 63;     // keys are 32 bits; 0 = empty slot
+struct TBRegSlot {
+    std::atomic<uint64_t> key{0};
+    std::atomic<const TBTable*> table{nullptr};
+};
+static EngineMutex g_tb_mutex;                       // serializes loads and tb_forget_tables()
+static TBRegSlot g_tb_registry[TB_REG_SIZE];
+static std::vector<std::unique_ptr<TBTable>> g_tb_owned; // guarded by g_tb_mutex
+static const TBTable g_tb_missing{};                 // sentinel: no file for this signature
+
+static std::string tb_path(const std::string& dir, const std::string& name) {
+    return dir + "/" + name + ".cctb";
+}
+
+static std::unique_ptr<TBTable> tb_load_file(const std::string& path, const TBMaterial& mat) {
+    auto t = std::make_unique<TBTable>();
+    t->mat = mat;
+    tb_build_slots(*t);
+    TBFileHeader hdr{};
+    if (!t->file.open(path) || t->file.size < sizeof(hdr)) return nullptr;
+    std::memcpy(&hdr, t->file.data, sizeof(hdr));
+    t->data = t->file.data + sizeof(hdr);
+    if (std::memcmp(hdr.magic, TB_MAGIC, sizeof(TB_MAGIC)) != 0 || hdr.entries != t->entries ||
+        t->file.size - sizeof(hdr) < t->entries ||
+        mat.name() != std::string(hdr.name, strnlen(hdr.name, sizeof(hdr.name))))
+        return nullptr;
+    t->max_plies = (int)hdr.max_plies;
+    return t;
+}
+
+static bool tb_save_file(const std::string& path, const TBTable& t) {
+    TBFileHeader hdr{};
+    std::memcpy(hdr.magic, TB_MAGIC, sizeof(TB_MAGIC));
+    hdr.entries = t.entries;
+    hdr.max_plies = (uint32_t)t.max_plies;
+    std::string name = t.mat.name();
+    std::memcpy(hdr.name, name.data(), std::min(name.size(), sizeof(hdr.name) - 1));
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    out.write(reinterpret_cast<const char*>(t.data), (std::streamsize)t.entries);
+    return (bool)out;
+}
+
+static inline std::size_t tb_reg_home(uint64_t key) {
+    return (std::size_t)((key * 0x9E3779B97F4A7C15ULL) >> 49) & (TB_REG_SIZE - 1);
+}
+
+// Slow path of tb_table_for(): opens the file and publishes the slot.
+static const TBTable* tb_register_table(const TBMaterial& mat, const std::string& dir) {
+    const uint64_t key = mat.key() | TB_REG_USED;
+    std::lock_guard<EngineMutex> lk(g_tb_mutex);
+    for (std::size_t i = tb_reg_home(key), n = 0; n < (std::size_t)TB_REG_SIZE;
+         i = (i + 1) & (TB_REG_SIZE - 1), n++) {
+        TBRegSlot& s = g_tb_registry[i];
+        uint64_t k = s.key.load(std::memory_order_relaxed);
+        if (k == key) {
+            const TBTable* t = s.table.load(std::memory_order_relaxed);
+            return t == &g_tb_missing ? nullptr : t;
+        }
+        if (k != 0) continue;
+        std::unique_ptr<TBTable> loaded = tb_load_file(tb_path(dir, mat.name()), mat);
+        const TBTable* t = loaded ? loaded.get() : &g_tb_missing;
+        if (loaded) g_tb_owned.push_back(std::move(loaded));
+        s.table.store(t, std::memory_order_relaxed);
+        s.key.store(key, std::memory_order_release);
+        return t == &g_tb_missing ? nullptr : t;
+    }
+    return nullptr; // registry full
+}
+
+// Loaded table for `mat`, or nullptr. Tables stay mapped until
+// tb_forget_tables(), which must not run while a search is probing.
+static const TBTable* tb_table_for(const TBMaterial& mat) {
+    const std::string& dir = get_engine_config().tablebase_dir;
+    if (dir.empty()) return nullptr;
+    const uint64_t key = mat.key() | TB_REG_USED;
+    for (std::size_t i = tb_reg_home(key), n = 0; n < (std::size_t)TB_REG_SIZE;
+         i = (i + 1) & (TB_REG_SIZE - 1), n++) {
+        const TBRegSlot& s = g_tb_registry[i];
+        uint64_t k = s.key.load(std::memory_order_acquire);
+        if (k == key) {
+            const TBTable* t = s.table.load(std::memory_order_relaxed);
+            return t == &g_tb_missing ? nullptr : t;
+        }
+        if (k == 0) break;
+    }
+    return tb_register_table(mat, dir);
+}
+
+static void tb_forget_tables() {
+    std::lock_guard<EngineMutex> lk(g_tb_mutex);
+    for (auto& s : g_tb_registry) {
+        s.key.store(0, std::memory_order_relaxed);
+        s.table.store(nullptr, std::memory_order_relaxed);
+    }
+    g_tb_owned.clear();
+}
+
+// Exact Full Battle result for `stm` to move, or wdl == None.
+static TBProbe tb_probe(const PieceList& pieces, Player stm) {
+    if (pieces.size() > (std::size_t)(2 + 4 + TB_MAX_UNITS)) return {};
+    TBMaterial mat;
+    if (!tb_material_of(pieces, mat)) return {};
+    const TBTable* t = tb_table_for(mat);
+    if (!t) return {};
+    uint64_t idx = 0;
+    if (!tb_encode(*t, pieces, stm, idx)) return {};
+    return tb_decode_value(t->data[idx]);
+}
+
+// Search score of a probe from the side to move's point of view.
+static inline int tb_score(const TBProbe& r, int ply) {
+    if (r.wdl == TBWdl::Win) return TB_WIN_SCORE - ply - r.plies;
+    if (r.wdl == TBWdl::Loss) return -(TB_WIN_SCORE - ply - r.plies);
+    return 0;
+}
+
+// Root move from the tablebase: fastest win, else any draw, else the longest
+// loss. False unless every reply is covered (or some move wins outright).
+static bool tb_pick_root_move(const PieceList& pieces, Player cpu_player, GameMode mode,
+                              MoveTriple& out) {
+    if (mode != GameMode::FULL_BATTLE) return false;
+    TBProbe here = tb_probe(pieces, cpu_player);
+    if (here.wdl == TBWdl::None) return false;
+    bool have = false, all_known = true;
+    int best_rank = std::numeric_limits<int>::min();
+    for (const auto& m : all_moves_for(pieces, cpu_player)) {
+        PieceList np = pieces;
+        if (!apply_move_unchecked_inplace(np, m.pid, m.dc, m.dr, cpu_player)) continue;
+        int rank;
+        if (side_has_won_t<GameMode::FULL_BATTLE>(np, cpu_player)) {
+            out = m;
+            return true;
+        }
+        TBProbe r = tb_probe(np, opp(cpu_player));
+        if (r.wdl == TBWdl::None) { all_known = false; continue; }
+        if (r.wdl == TBWdl::Loss) rank = 1000 - r.plies;      // we win: shortest first
+        else if (r.wdl == TBWdl::Draw) rank = 0;
+        else rank = -1000 + r.plies;                          // we lose: hold out longest
+        if (!have || rank > best_rank) { best_rank = rank; out = m; have = true; }
+    }
+    return have && (best_rank > 0 || all_known);
+}
+
+// ── Generator ──
+// Forward retrograde analysis: pass p settles every position whose exact
+// distance is p plies, reading children from this table (settled in earlier
+// passes) and from already generated smaller tables. Positions with a child
+// that no table covers stay unresolved unless they win anyway.
+static bool tb_generate_table(const TBMaterial& mat, const std::string& dir, std::ostream& log) {
+    TBTable t;
+    t.mat = mat;
+    tb_build_slots(t);
+    t.owned.assign((std::size_t)t.entries, TB_NONE);
+    t.data = t.owned.data();
+    std::vector<uint8_t> unknown_child((std::size_t)t.entries, 0);
+    auto t0 = std::chrono::steady_clock::now();
+
+    PieceList pos;
+    Player stm;
+    uint64_t valid = 0;
+    for (uint64_t i = 0; i < t.entries; i++) {
+        if (!tb_decode(t, i, pos, stm, true)) continue;
+        t.owned[(std::size_t)i] = 0;
+        valid++;
+    }
+
+    std::vector<uint8_t> settled((std::size_t)t.entries, 0);
+    int quiet_passes = 0;
+    int dep_plies = 0; // deepest result read from another table; passes can't stop before it
+    int p = 1;
+    for (; p <= TB_MAX_PLIES; p++) {
+        uint64_t changed = 0;
+        for (uint64_t i = 0; i < t.entries; i++) {
+            if (t.owned[(std::size_t)i] != 0 || settled[(std::size_t)i]) continue;
+            tb_decode(t, i, pos, stm, false);
+            AllMoves moves = all_moves_for(pos, stm);
+            if (moves.empty()) { settled[(std::size_t)i] = 1; continue; } // no moves: draw
+            int best_win = std::numeric_limits<int>::max();
+            int worst_loss = 0;
+            bool all_lose = true;
+            for (const auto& m : moves) {
+                PieceList child = pos;
+                if (!apply_move_unchecked_inplace(child, m.pid, m.dc, m.dr, stm)) continue;
+                if (side_has_won_t<GameMode::FULL_BATTLE>(child, stm)) { best_win = 1; break; }
+                TBProbe r;
+                TBMaterial cm;
+                uint64_t ci = 0;
+                if (tb_material_of(child, cm) && cm == mat) {
+                    if (tb_encode(t, child, opp(stm), ci)) {
+                        uint8_t v = t.owned[(std::size_t)ci];
+                        if (v != 0 || settled[(std::size_t)ci]) r = tb_decode_value(v);
+                        else { all_lose = false; continue; } // still open
+                    }
+                } else {
+                    r = tb_probe(child, opp(stm));
+                    if (r.wdl != TBWdl::None) dep_plies = std::max(dep_plies, r.plies);
+                }
+                if (r.wdl == TBWdl::None) { unknown_child[(std::size_t)i] = 1; all_lose = false; continue; }
+                if (r.wdl == TBWdl::Loss) best_win = std::min(best_win, r.plies + 1);
+                else if (r.wdl == TBWdl::Win) worst_loss = std::max(worst_loss, r.plies + 1);
+                if (r.wdl != TBWdl::Win) all_lose = false;
+            }
+            if (best_win <= p) {
+                t.owned[(std::size_t)i] = tb_encode_value(TBWdl::Win, best_win);
+                changed++;
+            } else if (all_lose && !unknown_child[(std::size_t)i] && worst_loss <= p) {
+                t.owned[(std::size_t)i] = tb_encode_value(TBWdl::Loss, worst_loss);
+                changed++;
+            }
+        }
+        if (changed) { t.max_plies = p; quiet_passes = 0; }
+        else if (++quiet_passes >= 2 && p > dep_plies + 2) break;
+    }
+    uint64_t wins = 0, losses = 0, draws = 0, uncovered = 0;
+    for (uint64_t i = 0; i < t.entries; i++) {
+        uint8_t& v = t.owned[(std::size_t)i];
+        if (v == 0 && !settled[(std::size_t)i] && (unknown_child[(std::size_t)i] || p > TB_MAX_PLIES)) {
+            v = TB_NONE;
+            uncovered++;
+        }
+        if (v == 0) draws++;
+        else if (v < 128) wins++;
+        else if (v != TB_NONE) losses++;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    log << "[tb] " << mat.name() << ": " << valid << " positions, " << wins << " wins, "
+        << losses << " losses, " << draws << " draws, " << uncovered << " uncovered, max "
+        << t.max_plies << " plies, " << std::fixed << std::setprecision(1) << secs << "s\n";
+    return tb_save_file(tb_path(dir, mat.name()), t);
+}
+
+// Generates every table with up to `max_units` units whose index fits in
+// `max_mb` megabytes, smallest material first so captures resolve into
+// tables that already exist.
+static int tb_generate_all(const std::string& dir, int max_units, int max_mb, std::ostream& log) {
+    static const PieceKind kUnitKinds[] = {
+        PieceKind::Infantry, PieceKind::Militia, PieceKind::Tank, PieceKind::Engineer, PieceKind::Artillery,
+        PieceKind::AntiAircraft, PieceKind::Missile, PieceKind::AirForce, PieceKind::Navy};
+    const int n_kinds = (int)(sizeof(kUnitKinds) / sizeof(kUnitKinds[0]));
+    max_units = std::max(0, std::min(max_units, TB_MAX_UNITS));
+
+    // All sorted unit multisets of each size.
+    std::vector<std::vector<PieceKind>> sets[TB_MAX_UNITS + 1];
+    sets[0].push_back({});
+    for (int n = 1; n <= TB_MAX_UNITS; n++)
+        for (const auto& base : sets[n - 1])
+            for (int k = 0; k < n_kinds; k++)
+                if (base.empty() || kind_index(kUnitKinds[k]) >= kind_index(base.back())) {
+                    auto next = base;
+                    next.push_back(kUnitKinds[k]);
+                    sets[n].push_back(next);
+                }
+
+    std::vector<TBMaterial> todo;
+    for (int units = 0; units <= max_units; units++)
+        for (int red_units = 0; red_units <= units; red_units++)
+            for (const auto& ru : sets[red_units])
+                for (const auto& bu : sets[units - red_units])
+                    for (int hq = 0; hq < 16; hq++) {
+                        TBMaterial m;
+                        m.hq_mask[0] = (uint8_t)(hq & 3);
+                        m.hq_mask[1] = (uint8_t)(hq >> 2);
+                        m.n_units[0] = (int)ru.size();
+                        m.n_units[1] = (int)bu.size();
+                        std::copy(ru.begin(), ru.end(), m.units[0].begin());
+                        std::copy(bu.begin(), bu.end(), m.units[1].begin());
+                        todo.push_back(m);
+                    }
+    auto piece_count = [](const TBMaterial& m) {
+        return m.n_units[0] + m.n_units[1] + __builtin_popcount(m.hq_mask[0]) + __builtin_popcount(m.hq_mask[1]);
+    };
+    std::stable_sort(todo.begin(), todo.end(), [&](const TBMaterial& a, const TBMaterial& b) {
+        return piece_count(a) < piece_count(b);
+    });
+
+    EngineConfig cfg = get_engine_config();
+    cfg.tablebase_dir = dir;
+    set_engine_config(cfg);
+    tb_forget_tables();
+    int written = 0;
+    for (const auto& m : todo) {
+        TBTable probe_size;
+        probe_size.mat = m;
+        tb_build_slots(probe_size);
+        if (probe_size.entries > (uint64_t)max_mb * 1024 * 1024) {
+            log << "[tb] " << m.name() << ": skipped (" << (probe_size.entries >> 20) << " MB index)\n";
+            continue;
+        }
+        if (!tb_generate_table(m, dir, log)) {
+            log << "[tb] " << m.name() << ": cannot write " << tb_path(dir, m.name()) << "\n";
+            return 1;
+        }
+        tb_forget_tables(); // drop cached misses so the new table is picked up
+        written++;
+    }
+    log << "[tb] wrote " << written << " tables to " << dir << "\n";
+    return 0;
+}
+
+// ── LMR Reduction Table (logarithmic) ────────────────────────────────────
+static int g_lmr_table[64][64];
+static bool g_lmr_init = false;
+
+static void init_lmr_table() {
+    if (g_lmr_init) return;
+    // Stockfish 18 LMR formula: reduction ≈ ln(depth) * ln(moves) / 2.0
+    // (slightly more aggressive than the old /2.25; improves search speed
+    //  at depth ≥ 6 where later moves are almost always sub-optimal)
+    for (int d = 0; d < 64; d++) {
+        for (int m = 0; m < 64; m++) {
+            if (d == 0 || m == 0) { g_lmr_table[d][m] = 0; continue; }
+            g_lmr_table[d][m] = (int)(0.50 + std::log(d) * std::log(m) / 2.0);
+            if (g_lmr_table[d][m] < 0) g_lmr_table[d][m] = 0;
+        }
+    }
+    g_lmr_init = true;
+}
+
+static int lmr_reduction(int depth, int move_index) {
+    int d = std::min(depth, 63);
+    int m = std::min(move_index, 63);
+    return g_lmr_table[d][m];
+}
+
+// ── Alpha-Beta with PVS + LMR + NMP + SEE Pruning + Improving ───────────
+static thread_local std::chrono::steady_clock::time_point g_deadline;
+static thread_local const std::atomic<bool>* g_stop_flag = nullptr;
 
 // Throttled time check: only syscall every 4096 nodes to reduce overhead.
 static thread_local uint64_t g_time_check_counter = 0;
@@ -4116,7 +5664,8 @@ static bool time_up() {
     // WASM-SAFE: throttle wall-clock reads to once per 4096 node checks.
     if (((++g_time_check_counter) & 4095ULL) != 0) return false;
     bool up = std::chrono::steady_clock::now() > g_deadline ||
-              (g_stop_flag && g_stop_flag->load(std::memory_order_relaxed));
+              (g_stop_flag && g_stop_flag->load(std::memory_order_relaxed)) ||
+              node_limit_reached();
     if (up) g_time_up_cache = true;
     return up;
 }
@@ -4162,20 +5711,23 @@ static void seed_search_hash_path_from_history(const std::vector<uint64_t>& hist
     }
 }
 
-static int alphabeta(SearchState& st, int depth, int alpha, int beta,
-                     Player cpu_player, int ply,
-                     bool null_ok=true, const MoveTriple* prev_move=nullptr,
-                     ThreadData* td=nullptr) {
+template <GameMode M>
+static int alphabeta_t(SearchState& st, int depth, int alpha, int beta,
+                       Player cpu_player, int ply,
+                       bool null_ok, const MoveTriple* prev_move,
+                       ThreadData* td) {
     SearchPathGuard path_guard(st.hash);
     if (path_is_threefold(st.hash)) return 0;
     g_nodes.fetch_add(1, std::memory_order_relaxed);
+    g_thread_nodes++;
+    if (ply >= 1 && ply <= MAX_PLY) g_ply_move[ply - 1] = prev_move ? *prev_move : MoveTriple{-1, -1, -1};
     const bool node_is_max = (st.turn == cpu_player);
     if (ply < MAX_PLY) { if (td) td->pv_len[ply] = ply; else g_pv_len[ply] = ply; }
 
     // Hard safety guard against runaway recursion in extended lines.
     if (ply >= MAX_PLY) {
-        if (node_is_max) return quiesce(st, alpha, beta, cpu_player, cpu_player);
-        return -quiesce(st, -beta, -alpha, opp(cpu_player), cpu_player);
+        if (node_is_max) return quiesce_t<M>(st, alpha, beta, cpu_player, cpu_player, 0, td);
+        return -quiesce_t<M>(st, -beta, -alpha, opp(cpu_player), cpu_player, 0, td);
     }
 
     int orig_alpha = alpha;
@@ -4184,34 +5736,48 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
 
     // ── Terminal: win check ───────────────────────────────────────────────
     Player last_mover = opp(st.turn);
-    std::string win = check_win(st.pieces, last_mover);
-    if (!win.empty()) {
+    if (side_has_won_t<M>(st.pieces, last_mover)) {
         int base = 40000 + depth*100;
         return (last_mover == cpu_player) ? base : -base;
     }
+    // ── Endgame tablebase: exact result replaces the fortress heuristics ──
+    if constexpr (M == GameMode::FULL_BATTLE) {
+        if (ply > 0) {
+            TBProbe tb = tb_probe(st.pieces, st.turn);
+            if (tb.wdl != TBWdl::None) {
+                int v = tb_score(tb, ply);
+                return (st.turn == cpu_player) ? v : -v;
+            }
+        }
+    }
     if (depth <= 3 && depth > 0) {
         int special_score = 0;
-        if (low_depth_special_outcome(st, cpu_player, depth, &special_score))
+        if (low_depth_special_outcome<M>(st, cpu_player, depth, &special_score))
             return special_score;
     }
     if (depth == 0) {
         // Quiescence is negamax-style from side-to-move perspective.
-        if (node_is_max) return quiesce(st, alpha, beta, cpu_player, cpu_player);
-        return -quiesce(st, -beta, -alpha, opp(cpu_player), cpu_player);
+        if (node_is_max) return quiesce_t<M>(st, alpha, beta, cpu_player, cpu_player, 0, td);
+        return -quiesce_t<M>(st, -beta, -alpha, opp(cpu_player), cpu_player, 0, td);
     }
 
     // ── TT lookup ─────────────────────────────────────────────────────────
     uint64_t h = st.hash;
     const MoveTriple* hash_move_ptr = nullptr;
     MoveTriple hash_move_buf{};
-    const TTDecoded* tte = tt_probe(h);
+    const TTDecoded* tte = tt_probe(h, td);
     if (tte && tte->depth >= depth && !pv_node) {
         if      (tte->flag==TT_EXACT) return tte->val;
         else if (tte->flag==TT_LOWER && tte->val>alpha) alpha=tte->val;
         else if (tte->flag==TT_UPPER && tte->val<beta)  beta=tte->val;
         if (alpha >= beta) return tte->val;
     }
-    if (tte) { hash_move_buf = tt_unpack_move(*tte); hash_move_ptr = &hash_move_buf; }
+    if (tte && tte->mv_pid >= 0) {
+        // Drop hash moves that don't fit this position (key collisions); a
+        // valid one is searched by MovePicker before any generation.
+        hash_move_buf = tt_unpack_move(*tte);
+        if (move_is_pseudo_legal(st, hash_move_buf)) hash_move_ptr = &hash_move_buf;
+    }
 
     // ── Internal Iterative Reduction (IIR) ───────────────────────────────
     // When we have no hash move, reduce depth by 1 instead of expensive IID.
@@ -4261,13 +5827,13 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
     if (pruning_safe && !pv_node && depth <= 3) {
         int razor_margin = 200 + 180 * (depth - 1);
         if (node_is_max && static_eval + razor_margin <= alpha) {
-            if (depth <= 1) return quiesce(st, alpha, beta, cpu_player, cpu_player);
-            int razor_val = quiesce(st, alpha, beta, cpu_player, cpu_player);
+            if (depth <= 1) return quiesce_t<M>(st, alpha, beta, cpu_player, cpu_player, 0, td);
+            int razor_val = quiesce_t<M>(st, alpha, beta, cpu_player, cpu_player, 0, td);
             if (razor_val <= alpha) return razor_val;
         }
         if (!node_is_max && static_eval - razor_margin >= beta) {
-            if (depth <= 1) return -quiesce(st, -beta, -alpha, opp(cpu_player), cpu_player);
-            int razor_val = -quiesce(st, -beta, -alpha, opp(cpu_player), cpu_player);
+            if (depth <= 1) return -quiesce_t<M>(st, -beta, -alpha, opp(cpu_player), cpu_player, 0, td);
+            int razor_val = -quiesce_t<M>(st, -beta, -alpha, opp(cpu_player), cpu_player, 0, td);
             if (razor_val >= beta) return razor_val;
         }
     }
@@ -4280,13 +5846,13 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
         if (probcut_depth < 1) probcut_depth = 1;
         // Quick check: if static eval already beats probcut_beta, likely a cut
         if (node_is_max && static_eval >= probcut_beta) {
-            int pc_val = alphabeta(st, probcut_depth, probcut_beta - 1, probcut_beta,
+            int pc_val = alphabeta_t<M>(st, probcut_depth, probcut_beta - 1, probcut_beta,
                                    cpu_player, ply, false, prev_move, td);
             if (pc_val >= probcut_beta) return pc_val;
         }
         if (!node_is_max && static_eval <= alpha - 200) {
             int probcut_alpha = alpha - 200;
-            int pc_val = alphabeta(st, probcut_depth, probcut_alpha, probcut_alpha + 1,
+            int pc_val = alphabeta_t<M>(st, probcut_depth, probcut_alpha, probcut_alpha + 1,
                                    cpu_player, ply, false, prev_move, td);
             if (pc_val <= probcut_alpha) return pc_val;
         }
@@ -4330,9 +5896,9 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                 int null_val;
                 if (node_is_max) {
                     // Minimax search: keep cpu_player perspective and do not negate.
-                    null_val = alphabeta(ns, depth-1-R, beta-1, beta, cpu_player, ply+1, false, prev_move, td);
+                    null_val = alphabeta_t<M>(ns, depth-1-R, beta-1, beta, cpu_player, ply+1, false, prev_move, td);
                 } else {
-                    null_val = alphabeta(ns, depth-1-R, alpha, alpha+1, cpu_player, ply+1, false, prev_move, td);
+                    null_val = alphabeta_t<M>(ns, depth-1-R, alpha, alpha+1, cpu_player, ply+1, false, prev_move, td);
                 }
                 ns.turn = nu.turn_before;
                 ns.hash = nu.hash_before;
@@ -4343,7 +5909,7 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                 if (node_is_max) {
                     if (null_val >= beta) {
                         if (depth >= 8) {
-                            int verify = alphabeta(st, depth-R-1, beta-1, beta, cpu_player, ply+1, false, prev_move, td);
+                            int verify = alphabeta_t<M>(st, depth-R-1, beta-1, beta, cpu_player, ply+1, false, prev_move, td);
                             if (verify >= beta) return beta;
                         } else {
                             return beta;
@@ -4352,7 +5918,7 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                 } else {
                     if (null_val <= alpha) {
                         if (depth >= 8) {
-                            int verify = alphabeta(st, depth-R-1, alpha, alpha+1, cpu_player, ply+1, false, prev_move, td);
+                            int verify = alphabeta_t<M>(st, depth-R-1, alpha, alpha+1, cpu_player, ply+1, false, prev_move, td);
                             if (verify <= alpha) return alpha;
                         } else {
                             return alpha;
@@ -4366,19 +5932,13 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
     int pre_cpu_cmd_atk = commander_attackers_cached(st, cpu_player);
     int pre_opp_cmd_atk = commander_attackers_cached(st, opp(cpu_player));
     int pre_my_navy = st.navy_count[(cpu_player == Player::Red) ? 0 : 1];
-    AllMoves moves = all_moves_for(st.pieces, st.turn);
-    if (moves.empty()) {
-        ensure_attack_cache(st);
-        return board_score(st.pieces, cpu_player, &st.atk, &st.turn, &st);
-    }
-
     const MoveTriple* pv_move_ptr = nullptr;
     MoveTriple pv_move_buf{};
     if (ply < MAX_PLY && (td ? td->pv_len[ply] : g_pv_len[ply]) > ply) {
         pv_move_buf = td ? td->pv[ply][ply] : g_pv[ply][ply];
         pv_move_ptr = &pv_move_buf;
     }
-    MovePicker picker(moves, st.pieces, st.turn, ply, hash_move_ptr, pv_move_ptr, prev_move, td);
+    MovePicker picker(st, ply, hash_move_ptr, pv_move_ptr, prev_move, td);
 
     int val = node_is_max ? -999999 : 999999;
     MoveTriple best_move{};
@@ -4486,12 +6046,12 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                 int sing_beta = tt_val - 90;
                 bool is_singular = true;
                 int tested = 0, near_miss = 0;
-                for (auto& om : moves) {
+                for (auto& om : picker.all_moves()) {
                     if (same_move(om, m)) continue;
                     if (tested >= 16 || time_up()) break;
                     UndoMove su;
                     if (!make_move_inplace_search(st, om, cpu_player, su)) continue;
-                    int sv = alphabeta(st, search_depth - 2, sing_beta - 1, sing_beta, cpu_player, ply + 1, false, &om, td);
+                    int sv = alphabeta_t<M>(st, search_depth - 2, sing_beta - 1, sing_beta, cpu_player, ply + 1, false, &om, td);
                     unmake_move_inplace(st, su);
                     ++tested;
                     if (sv >= sing_beta) { is_singular = false; break; }
@@ -4541,7 +6101,7 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
         int child;
         if (move_index == 0) {
             // PV move: full window
-            child = alphabeta(st, ext_depth, alpha, beta, cpu_player, ply+1, true, &m, td);
+            child = alphabeta_t<M>(st, ext_depth, alpha, beta, cpu_player, ply+1, true, &m, td);
         } else {
             int new_depth = ext_depth;
 
@@ -4565,21 +6125,21 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
 
             // Zero-window (PVS) search
             if (node_is_max)
-                child = alphabeta(st, new_depth, alpha, alpha+1, cpu_player, ply+1, true, &m, td);
+                child = alphabeta_t<M>(st, new_depth, alpha, alpha+1, cpu_player, ply+1, true, &m, td);
             else
-                child = alphabeta(st, new_depth, beta-1,  beta, cpu_player, ply+1, true, &m, td);
+                child = alphabeta_t<M>(st, new_depth, beta-1,  beta, cpu_player, ply+1, true, &m, td);
 
             // Re-search at full depth if LMR-reduced search beats the bound
             bool lmr_fail = node_is_max ? (child > alpha) : (child < beta);
             if (new_depth < ext_depth && lmr_fail) {
                 if (pv_node) {
                     // PV node: re-search directly with full window (skip extra ZW)
-                    child = alphabeta(st, ext_depth, alpha, beta, cpu_player, ply+1, true, &m, td);
+                    child = alphabeta_t<M>(st, ext_depth, alpha, beta, cpu_player, ply+1, true, &m, td);
                 } else {
                     if (node_is_max)
-                        child = alphabeta(st, ext_depth, alpha, alpha+1, cpu_player, ply+1, true, &m, td);
+                        child = alphabeta_t<M>(st, ext_depth, alpha, alpha+1, cpu_player, ply+1, true, &m, td);
                     else
-                        child = alphabeta(st, ext_depth, beta-1, beta, cpu_player, ply+1, true, &m, td);
+                        child = alphabeta_t<M>(st, ext_depth, beta-1, beta, cpu_player, ply+1, true, &m, td);
                 }
             }
 
@@ -4588,7 +6148,7 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                 bool pvs_fail = node_is_max ? (child > alpha && child < beta)
                                             : (child < beta  && child > alpha);
                 if (pvs_fail && pv_node) {
-                    child = alphabeta(st, ext_depth, alpha, beta, cpu_player, ply+1, true, &m, td);
+                    child = alphabeta_t<M>(st, ext_depth, alpha, beta, cpu_player, ply+1, true, &m, td);
                 }
             }
         }
@@ -4625,9 +6185,9 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                     if (td) { td_store_killer(*td, m, ply); } else { store_killer(m, ply); }
                     if (moved_ki >= 0) {
                         if (td) { td_update_history(*td, hist_pl, moved_ki, m.dc, m.dr, depth);
-                                  td_update_cont_history(*td, prev_move, moved_ki, m.dc, m.dr, depth); }
+                                  td_update_cont_history(*td, prev_move, ply, moved_ki, m.dc, m.dr, depth); }
                         else    { update_history(hist_pl, moved_ki, m.dc, m.dr, depth);
-                                  update_cont_history(prev_move, moved_ki, m.dc, m.dr, depth); }
+                                  update_cont_history(prev_move, ply, moved_ki, m.dc, m.dr, depth); }
                     }
                     // History malus: penalise other quiet moves that didn't cause cutoff
                     for (int qi = 0; qi < searched_quiet_count; qi++) {
@@ -4666,9 +6226,9 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
                     if (td) { td_store_killer(*td, m, ply); } else { store_killer(m, ply); }
                     if (moved_ki >= 0) {
                         if (td) { td_update_history(*td, hist_pl, moved_ki, m.dc, m.dr, depth);
-                                  td_update_cont_history(*td, prev_move, moved_ki, m.dc, m.dr, depth); }
+                                  td_update_cont_history(*td, prev_move, ply, moved_ki, m.dc, m.dr, depth); }
                         else    { update_history(hist_pl, moved_ki, m.dc, m.dr, depth);
-                                  update_cont_history(prev_move, moved_ki, m.dc, m.dr, depth); }
+                                  update_cont_history(prev_move, ply, moved_ki, m.dc, m.dr, depth); }
                     }
                     for (int qi = 0; qi < searched_quiet_count; qi++) {
                         const auto& sq = searched_quiets[qi];
@@ -4711,6 +6271,16 @@ static int alphabeta(SearchState& st, int depth, int alpha, int beta,
     return val;
 }
 
+static int alphabeta(SearchState& st, int depth, int alpha, int beta,
+                     Player cpu_player, int ply,
+                     bool null_ok=true, const MoveTriple* prev_move=nullptr,
+                     ThreadData* td=nullptr) {
+    return dispatch_game_mode(st.mode, [&](auto m) {
+        return alphabeta_t<decltype(m)::value>(st, depth, alpha, beta, cpu_player, ply,
+                                               null_ok, prev_move, td);
+    });
+}
+
 struct AIResult { bool found; MoveTriple move; };
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -4718,8 +6288,16 @@ struct AIResult { bool found; MoveTriple move; };
 // ═══════════════════════════════════════════════════════════════════════════
 //
 // Architecture:
-//   • Root:  Monte-Carlo Tree Search with PUCT selection guided by a
-//            heuristic "policy head" (captures/mobility/positional priors).
+//   • Tree:  full-depth Monte-Carlo Tree Search with PUCT selection guided
+//            by a heuristic "policy head" (captures/mobility/positional
+//            priors); nodes come from a per-search arena (mcts_arena_mb).
+//            Children are kept in prior order and progressively widened:
+//            a node with N visits only competes its first
+//            MCTS_WIDEN_BASE + MCTS_WIDEN_SCALE·√N children.
+//   • Solver: decisive value-head results and won positions are marked
+//            as proven; a won child proves its parent lost, all children
+//            lost prove it won. Proven subtrees are not searched further
+//            and a proven root ends the search early.
 //   • Leaf:  Alpha-beta at engine_mcts_ab_depth() plies — acts as the "value head".
 //   • This eliminates the horizon effect that pure AB suffers at the root:
 //     promising moves receive exponentially more AB evaluations, naturally
@@ -4728,72 +6306,79 @@ struct AIResult { bool found; MoveTriple move; };
 
 static constexpr float MCTS_CPUCT    = 1.8f;  // exploration constant
 static constexpr float MCTS_VIRTUAL_LOSS = 0.35f;
-static constexpr int   MCTS_MAX_THREADS = 8;
+static constexpr int   MCTS_MAX_THREADS = 64; // sanity bound; the tree itself is lock-free
 static constexpr int   MCTS_EVAL_BATCH_CPU = 16;
 static constexpr int   MCTS_EVAL_BATCH_WEBGPU = 128;
 
 // ── Heuristic policy prior (simulates NNUE policy head) ──────────────────
-// Returns a softmax probability vector over the given moves.
-static std::vector<float> mcts_policy_priors(const AllMoves& moves,
-                                              const PieceList& pieces,
-                                              Player player) {
+// exp(x) for x <= 0, accurate to ~1e-3 relative: 2^t split into an exponent
+// (written straight into the float bits) and a degree-4 polynomial for the
+// fraction. Branch-free, so the softmax loop below auto-vectorizes.
+static inline float mcts_fast_exp(float x) {
+    float t = std::max(x, -80.0f) * 1.44269504f; // log2(e)
+    float fi = std::floor(t);
+    float f = t - fi;
+    float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f + f * 0.00961813f)));
+    int32_t bits = ((int32_t)fi + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// Returns a softmax probability vector over `moves` for the side to move in
+// `st`. Board lookups go through the position's own caches (id/square
+// tables, cached Commander squares); captures are split into winning and
+// losing ones with see_ge(), whose movegen context is built once per call.
+static std::vector<float> mcts_policy_priors(const AllMoves& moves, const SearchState& st) {
     if (moves.empty()) return {};
+    const Player player = st.turn;
+    const int me = player_idx(player);
+    const int them = 1 - me;
     std::vector<float> raw(moves.size(), 0.0f);
-    int hist_pl = player_idx(player);
-    if (hist_pl < 0) hist_pl = 0;
+    MoveGenContext see_ctx;
+    bool see_ctx_ready = false;
 
-    // Pre-locate commanders for threat/escape bonuses (O(n) once).
-    const Piece* my_cmd  = nullptr;
-    const Piece* opp_cmd = nullptr;
-    for (const auto& p : pieces) {
-        if (p.kind != PieceKind::Commander) continue;
-        if (p.player == player) my_cmd = &p;
-        else                    opp_cmd = &p;
-    }
+    const bool has_my_cmd = st.cmd_col[me] >= 0;
+    const bool has_opp_cmd = st.cmd_col[them] >= 0;
 
     for (size_t i = 0; i < moves.size(); i++) {
         const auto& m = moves[i];
         float s = 0.0f;
-
-        // Capture bonus: MVV/LVA-weighted with SEE refinement
-        const Piece* tgt = piece_at_c(pieces, m.dc, m.dr);
-        if (tgt && tgt->player != player) {
-            int victim = piece_value_fast(tgt->kind);
-            int atk_idx = find_piece_idx_by_id(pieces, m.pid);
-            int attacker = (atk_idx >= 0) ? std::max(1, piece_value_fast(pieces[atk_idx].kind)) : 1;
+        const int atk_idx = find_piece_idx_by_id_fast(st, m.pid);
+        const Piece* ap = (atk_idx >= 0) ? &st.pieces[(size_t)atk_idx] : nullptr;
+
+        // Capture bonus: MVV/LVA-weighted, refined by threshold SEE
+        const int tgt_idx = find_piece_idx_at_fast(st, m.dc, m.dr);
+        if (tgt_idx >= 0 && st.pieces[(size_t)tgt_idx].player != player) {
+            int victim = piece_value_fast(st.pieces[(size_t)tgt_idx].kind);
+            int attacker = ap ? std::max(1, piece_value_fast(ap->kind)) : 1;
             s += 300.0f + victim * 2.0f - attacker * 0.25f;
-            int sv = see(pieces, m.dc, m.dr, player);
-            s += sv >= 0 ? (50.0f + sv * 0.05f) : (sv * 0.02f);
+            if (!see_ctx_ready) { see_ctx = build_movegen_context(st.pieces); see_ctx_ready = true; }
+            if (see_ge(st, see_ctx, m, 0)) s += 50.0f + victim * 0.05f;
+            else s += (victim - attacker) * 0.02f;
         }
 
         // Central-control bonus
         float cdist = std::abs(m.dc - 5) + std::abs(m.dr - 6);
         s += std::max(0.0f, 18.0f - cdist * 2.5f);
 
-        // Forward-advance bonus (push pieces toward opponent)
-        int atk_idx = find_piece_idx_by_id(pieces, m.pid);
-        if (atk_idx >= 0) {
-            const Piece& ap = pieces[atk_idx];
-            float adv = (player == Player::Blue) ? (float)(ap.row - m.dr)
-                                           : (float)(m.dr - ap.row);
+        if (ap) {
+            // Forward-advance bonus (push pieces toward opponent)
+            float adv = (player == Player::Blue) ? (float)(ap->row - m.dr)
+                                                 : (float)(m.dr - ap->row);
             s += adv * 3.5f;
-        }
 
-        // History heuristic bonus from global table
-        if (atk_idx >= 0 && atk_idx < (int)pieces.size()) {
-                int ki = kind_index(pieces[atk_idx].kind);
-                if (ki >= 0 && ki < H_KINDS) {
-                    int hist = g_history[hist_pl][ki][m.dc][m.dr];
-                    s += (float)hist * 0.008f;
-                }
-            }
+            // History heuristic bonus from global table
+            int ki = kind_index(ap->kind);
+            if (ki >= 0 && ki < H_KINDS) s += (float)history_score(me, ki, m.dc, m.dr) * 0.008f;
+        }
 
         // ── Commander threat bonus ────────────────────────────────────────
         // Moves that bring a piece close to the enemy commander or that
         // directly threaten to capture it are far more important in
         // Commander Chess than central control alone.
-        if (opp_cmd) {
-            int dist = std::abs(m.dc - opp_cmd->col) + std::abs(m.dr - opp_cmd->row);
+        if (has_opp_cmd) {
+            int dist = std::abs(m.dc - st.cmd_col[them]) + std::abs(m.dr - st.cmd_row[them]);
             if (dist == 0)      s += 800.0f;  // captures commander (shouldn't happen normally)
             else if (dist <= 1) s += 350.0f;  // adjacent — direct threat
             else if (dist <= 2) s += 180.0f;  // very close
@@ -4803,15 +6388,13 @@ static std::vector<float> mcts_policy_priors(const AllMoves& moves,
         // ── Own-commander shelter / escape bonus ──────────────────────────
         // When our commander is threatened, prioritise moves that place a
         // piece as a bodyguard (nearby defender) or move commander to safety.
-        if (my_cmd) {
-            bool my_cmd_piece = (atk_idx >= 0 && pieces[atk_idx].kind == PieceKind::Commander);
-            int dist_to = std::abs(m.dc - my_cmd->col) + std::abs(m.dr - my_cmd->row);
-            if (my_cmd_piece) {
+        if (has_my_cmd && ap) {
+            int dist_to = std::abs(m.dc - st.cmd_col[me]) + std::abs(m.dr - st.cmd_row[me]);
+            if (ap->kind == PieceKind::Commander) {
                 // Commander moving: bonus for moving away from danger
                 s += 30.0f;
-            } else if (dist_to <= 2 && atk_idx >= 0) {
-                int dist_from = std::abs(pieces[atk_idx].col - my_cmd->col)
-                              + std::abs(pieces[atk_idx].row - my_cmd->row);
+            } else if (dist_to <= 2) {
+                int dist_from = std::abs(ap->col - st.cmd_col[me]) + std::abs(ap->row - st.cmd_row[me]);
                 if (dist_to < dist_from) s += 40.0f; // moving toward own commander = shelter
             }
         }
@@ -4822,10 +6405,20 @@ static std::vector<float> mcts_policy_priors(const AllMoves& moves,
     // Softmax with temperature τ = 25 (was 80).
     // Sharper temperature focuses simulations on stronger moves while
     // still preserving enough exploration for PUCT to function correctly.
-    float max_s = *std::max_element(raw.begin(), raw.end());
+    const size_t n = raw.size();
+    float* v = raw.data();
+    float max_s = v[0];
+    for (size_t i = 1; i < n; i++) max_s = std::max(max_s, v[i]);
+    const float inv_tau = 1.0f / 25.0f;
     float sum = 0.0f;
-    for (auto& v : raw) { v = std::exp((v - max_s) / 25.0f); sum += v; }
-    if (sum > 1e-9f) for (auto& v : raw) v /= sum;
+    for (size_t i = 0; i < n; i++) {
+        v[i] = mcts_fast_exp((v[i] - max_s) * inv_tau);
+        sum += v[i];
+    }
+    if (sum > 1e-9f) {
+        const float inv_sum = 1.0f / sum;
+        for (size_t i = 0; i < n; i++) v[i] *= inv_sum;
+    }
     return raw;
 }
 
@@ -4843,51 +6436,435 @@ struct MCTSRootChild {
     }
 };
 
-// ── Two-level MCTS: root children + their children ───────────────────────
-// Each root child can be further expanded one more ply.
-struct MCTSLevel2Child {
-    MoveTriple  move{};
-    float       prior       = 0.0f;
-    int         visits      = 0;
-    int         virtual_loss = 0;
-    float       total_value = 0.0f;
-    SearchState state;
-    float q() const { return visits > 0 ? total_value / (float)visits : 0.0f; }
+// ── Node-pool tree ────────────────────────────────────────────────────────
+// Nodes carry no board: positions are replayed from the root along the
+// selected path, so a node stays 28 bytes and the whole tree lives in one
+// pre-sized arena. A node's children are a contiguous range handed out by a
+// single bump allocation when the node is expanded; the arena is rewound at
+// the start of every search. When it fills up, leaves simply stop growing.
+//
+// The tree is lock-free: visit, value and virtual-loss counters are atomics
+// updated with relaxed ordering (PUCT tolerates slightly stale statistics),
+// and a node is expanded by whichever worker wins the CAS on `state` from
+// LEAF to EXPANDING. The child range is published by the release store of
+// EXPANDED; workers that find a node EXPANDING evaluate it as a leaf.
+static constexpr uint32_t MCTS_NO_NODE = 0xFFFFFFFFu;
+static constexpr int      MCTS_EXPAND_VISITS = 2;   // visits before a leaf grows children
+static constexpr int      MCTS_MAX_TREE_DEPTH = 64;
+static constexpr int      MCTS_LEAF_PLY_CAP = 8;    // ply passed to the AB value head
+static constexpr int      MCTS_WIDEN_BASE = 4;      // children selectable at zero visits
+static constexpr float    MCTS_WIDEN_SCALE = 1.5f;  // further children per √visit
+static constexpr int      MCTS_DECISIVE_SCORE = 30000; // AB scores at or beyond this are proofs
+static constexpr int      MCTS_PROVEN_VALUE = 40000;   // value backed up from a proven node
+
+enum : uint8_t { MCTS_LEAF = 0, MCTS_EXPANDING = 1, MCTS_EXPANDED = 2 };
+// Game-theoretic value of a node, for the side that played the move into it.
+enum : int8_t { MCTS_PROVEN_LOSS = -1, MCTS_UNPROVEN = 0, MCTS_PROVEN_WIN = 1 };
+
+struct MCTSNode {
+    int16_t  pid;
+    int8_t   dc, dr;           // move leading to this node
+    float    prior;
+    std::atomic<float>    total_value; // from the perspective of the side that played the move
+    std::atomic<int32_t>  visits;
+    std::atomic<int32_t>  virtual_loss;
+    uint32_t first_child;      // valid once state == MCTS_EXPANDED
+    uint16_t num_children;
+    std::atomic<uint8_t>  state;
+    std::atomic<int8_t>   proof;
+
+    // Only called on nodes no other worker can reach yet.
+    void init(const MoveTriple& m, float p) {
+        pid = (int16_t)m.pid; dc = (int8_t)m.dc; dr = (int8_t)m.dr;
+        prior = p;
+        total_value.store(0.0f, std::memory_order_relaxed);
+        visits.store(0, std::memory_order_relaxed);
+        virtual_loss.store(0, std::memory_order_relaxed);
+        first_child = MCTS_NO_NODE;
+        num_children = 0;
+        state.store(MCTS_LEAF, std::memory_order_relaxed);
+        proof.store(MCTS_UNPROVEN, std::memory_order_relaxed);
+    }
+    // Copies move and statistics (not the child range) from a quiescent node.
+    void copy_from(const MCTSNode& o) {
+        init(o.move(), o.prior);
+        total_value.store(o.total_value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        visits.store(o.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        proof.store(o.proof.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    MoveTriple move() const { return MoveTriple{pid, dc, dr}; }
+    int8_t proven() const { return proof.load(std::memory_order_relaxed); }
+    // First proof wins; proofs never change once set.
+    void prove(int8_t p) {
+        int8_t expected = MCTS_UNPROVEN;
+        proof.compare_exchange_strong(expected, p, std::memory_order_relaxed);
+    }
+    void add_value(float v) {
+        float cur = total_value.load(std::memory_order_relaxed);
+        while (!total_value.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {}
+    }
+    float q() const {
+        int v = visits.load(std::memory_order_relaxed);
+        return v > 0 ? total_value.load(std::memory_order_relaxed) / (float)v : 0.0f;
+    }
     float q_with_virtual_loss() const {
-        int v = visits + virtual_loss;
+        int vl = virtual_loss.load(std::memory_order_relaxed);
+        int v = visits.load(std::memory_order_relaxed) + vl;
         if (v <= 0) return 0.0f;
-        float tv = total_value - MCTS_VIRTUAL_LOSS * (float)virtual_loss;
+        float tv = total_value.load(std::memory_order_relaxed) - MCTS_VIRTUAL_LOSS * (float)vl;
         return tv / (float)v;
     }
-    int visits_with_virtual_loss() const { return visits + virtual_loss; }
+    int visits_with_virtual_loss() const {
+        return visits.load(std::memory_order_relaxed) + virtual_loss.load(std::memory_order_relaxed);
+    }
 };
+static_assert(sizeof(MCTSNode) <= 32, "MCTS node must stay compact");
+
+struct MCTSArena {
+    std::unique_ptr<MCTSNode[]> nodes;
+    std::size_t capacity = 0;
+    std::size_t requested_mb = 0;
+    std::atomic<uint32_t> used{0};
+
+    // Sizes the pool for `mb` megabytes (halving on allocation failure).
+    // Returns true if the block was reallocated, which leaves it empty;
+    // otherwise the nodes are kept.
+    bool reserve_mb(std::size_t mb) {
+        if (mb == requested_mb && nodes) return false;
+        requested_mb = mb;
+        std::size_t want = std::max<std::size_t>(1, mb) * 1024 * 1024 / sizeof(MCTSNode);
+        want = std::min<std::size_t>(want, MCTS_NO_NODE - 1);
+        while (capacity != want) {
+            try {
+                nodes.reset();
+                capacity = 0;
+                nodes.reset(new MCTSNode[want]);
+                capacity = want;
+            } catch (const std::bad_alloc&) {
+                if (want <= 4096) throw;
+                want /= 2;
+            }
+        }
+        rewind();
+        return true;
+    }
 
-struct MCTSLevel1Child {
-    MoveTriple  move{};
-    float       prior       = 0.0f;
-    int         visits      = 0;
-    int         virtual_loss = 0;
-    float       total_value = 0.0f;
-    SearchState state;
-    bool        expanded    = false;
-    std::vector<MCTSLevel2Child> children;
+    void rewind() { used.store(0, std::memory_order_relaxed); }
 
-    float q() const { return visits > 0 ? total_value / (float)visits : 0.0f; }
-    float q_with_virtual_loss() const {
-        int v = visits + virtual_loss;
-        if (v <= 0) return 0.0f;
-        float tv = total_value - MCTS_VIRTUAL_LOSS * (float)virtual_loss;
-        return tv / (float)v;
+    // First index of `n` consecutive nodes, or MCTS_NO_NODE when full.
+    uint32_t alloc(uint32_t n) {
+        uint32_t first = used.load(std::memory_order_relaxed);
+        do {
+            if (n > capacity - first) return MCTS_NO_NODE;
+        } while (!used.compare_exchange_weak(first, first + n, std::memory_order_relaxed));
+        return first;
+    }
+};
+
+// ── Transposition table (DAG mode) ───────────────────────────────────────
+// With mcts_transpositions on, every expanded position is entered in a
+// lock-free open-addressing table keyed by its Zobrist hash. A node reaching
+// a position that was already expanded elsewhere adopts that child range,
+// so transposed lines share one subtree and its statistics (the tree becomes
+// a DAG; edge statistics above the shared range stay per parent). The table
+// also caches each position's leaf value so the AB value head runs once per
+// position. Entries are published with CAS and never removed mid-search.
+// Every word carries the search generation that wrote it: a new search bumps
+// the generation instead of clearing the table, and words from older
+// generations read as empty and are overwritten in place. The table is only
+// really cleared when the 8-bit generation wraps.
+static constexpr int MCTS_POS_PROBE = 16;
+
+struct MCTSPosEntry {
+    std::atomic<uint64_t> key;   // hash with its low byte replaced by the generation; 0 = empty
+    std::atomic<uint64_t> range; // gen << 56 | first_child << 16 | num_children; 0 = none
+    std::atomic<uint64_t> value; // gen << 32 | uint32 leaf value; 0 = none
+};
+
+struct MCTSPosTable {
+    std::unique_ptr<MCTSPosEntry[]> entries;
+    std::size_t mask = 0;
+    uint64_t gen = 1; // 1..255
+
+    void reserve_bytes(std::size_t bytes) {
+        std::size_t n = 1024;
+        while (n * 2 * sizeof(MCTSPosEntry) <= bytes) n <<= 1;
+        if (entries && mask + 1 == n) return;
+        entries.reset(new MCTSPosEntry[n]);
+        mask = n - 1;
+        clear();
+    }
+    void clear() {
+        for (std::size_t i = 0; i <= mask; i++) {
+            entries[i].key.store(0, std::memory_order_relaxed);
+            entries[i].range.store(0, std::memory_order_relaxed);
+            entries[i].value.store(0, std::memory_order_relaxed);
+        }
+        gen = 1;
+    }
+    // Starts a search: everything published so far becomes stale in O(1).
+    // Called only while no worker is running.
+    void next_generation() {
+        if (++gen > 0xFF) clear();
+    }
+
+    // Entry for `hash`, inserting it if absent; nullptr once the probe
+    // window is full.
+    MCTSPosEntry* find_or_insert(uint64_t hash) {
+        const uint64_t key = (hash & ~0xFFULL) | gen;
+        for (int i = 0; i < MCTS_POS_PROBE; i++) {
+            MCTSPosEntry& e = entries[(std::size_t)(hash + (uint64_t)i) & mask];
+            uint64_t cur = e.key.load(std::memory_order_acquire);
+            if (cur == key) return &e;
+            if (cur == 0 || (cur & 0xFF) != gen) {
+                if (e.key.compare_exchange_strong(cur, key, std::memory_order_acq_rel)) return &e;
+                if (cur == key) return &e;
+            }
+        }
+        return nullptr;
+    }
+
+    bool get_range(const MCTSPosEntry& e, uint32_t& first, uint16_t& count) const {
+        uint64_t r = e.range.load(std::memory_order_acquire);
+        if ((r >> 56) != gen) return false;
+        first = (uint32_t)(r >> 16);
+        count = (uint16_t)(r & 0xFFFF);
+        return true;
+    }
+    // First range published in this generation wins.
+    void publish_range(MCTSPosEntry& e, uint32_t first, uint16_t count) const {
+        const uint64_t want = gen << 56 | (uint64_t)first << 16 | count;
+        uint64_t cur = e.range.load(std::memory_order_relaxed);
+        while ((cur >> 56) != gen) {
+            if (e.range.compare_exchange_weak(cur, want, std::memory_order_release,
+                                              std::memory_order_relaxed)) return;
+        }
+    }
+    bool get_value(const MCTSPosEntry& e, int& out) const {
+        uint64_t v = e.value.load(std::memory_order_relaxed);
+        if ((v >> 32) != gen) return false;
+        out = (int)(int32_t)(uint32_t)v;
+        return true;
+    }
+    void put_value(MCTSPosEntry& e, int v) const {
+        e.value.store(gen << 32 | (uint32_t)v, std::memory_order_relaxed);
+    }
+};
+
+// ── Tree reuse between moves ──────────────────────────────────────────────
+// The tree outlives the search. On the next call for the same side, the node
+// two plies below the old root that matches the new position (our move, then
+// the opponent's reply) becomes the new root: its subtree is copied into the
+// spare arena and the old arena is rewound in O(1). The position table takes
+// an eighth of mcts_arena_mb and the two arenas split the rest, so together
+// they stay within the configured limit.
+struct MCTSTree {
+    MCTSArena arenas[2];
+    MCTSPosTable positions;
+    int active = 0;
+    uint32_t root = MCTS_NO_NODE;
+    PieceList root_pieces;
+    Player cpu_player = Player::Red;
+    GameMode mode = GameMode::FULL_BATTLE;
+    int ab_depth = 0;
+
+    void resize(std::size_t mb) {
+        mb = std::max<std::size_t>(2, mb);
+        const std::size_t table_mb = std::max<std::size_t>(1, mb / 8);
+        const std::size_t half = std::max<std::size_t>(1, (mb - table_mb) / 2);
+        positions.reserve_bytes(table_mb * 1024 * 1024);
+        bool changed = arenas[0].reserve_mb(half);
+        changed = arenas[1].reserve_mb(half) || changed;
+        if (changed) root = MCTS_NO_NODE;
+    }
+};
+
+static EngineMutex g_mcts_arena_mutex; // guards g_mcts_tree across searches
+static MCTSTree g_mcts_tree;
+
+// Node two plies below the kept root whose position is `new_root`, or
+// MCTS_NO_NODE. Only expanded branches are replayed.
+static uint32_t mcts_find_reroot(const MCTSTree& tree, const SearchState& new_root,
+                                 Player cpu_player, int ab_depth) {
+    if (tree.root == MCTS_NO_NODE || tree.cpu_player != cpu_player ||
+        tree.mode != new_root.mode || tree.ab_depth != ab_depth) return MCTS_NO_NODE;
+    const MCTSNode* nodes = tree.arenas[tree.active].nodes.get();
+    const MCTSNode& root = nodes[tree.root];
+    if (root.state.load(std::memory_order_relaxed) != MCTS_EXPANDED) return MCTS_NO_NODE;
+
+    SearchState st = make_search_state(tree.root_pieces, cpu_player, cpu_player, tree.mode);
+    for (uint32_t c = root.first_child; c < root.first_child + root.num_children; c++) {
+        const MCTSNode& ours = nodes[c];
+        if (ours.state.load(std::memory_order_relaxed) != MCTS_EXPANDED || ours.num_children == 0) continue;
+        UndoMove u1;
+        if (!make_move_inplace(st, ours.move(), cpu_player, u1)) continue;
+        for (uint32_t g = ours.first_child; g < ours.first_child + ours.num_children; g++) {
+            UndoMove u2;
+            if (!make_move_inplace(st, nodes[g].move(), cpu_player, u2)) continue;
+            // The incremental hash skips side effects on other pieces (heroic
+            // promotion), so compare the full hash make_search_state gave new_root.
+            const bool hit = st.turn == new_root.turn &&
+                (zobrist_hash(st.pieces, st.turn) ^ zobrist_cpu_perspective_salt(cpu_player)) == new_root.hash;
+            unmake_move_inplace(st, u2);
+            if (hit) return g;
+        }
+        unmake_move_inplace(st, u1);
+    }
+    return MCTS_NO_NODE;
+}
+
+// Copies the subtree under `src`, whose position is `st`, into `to`. Each
+// child range is copied whole before its members' subtrees, so ranges stay
+// contiguous; the copy can never outgrow `to` (an arena the size of `from`),
+// and a failed allocation just leaves a leaf. A child range shared by several
+// parents (DAG mode) is copied once. With a `table`, every copied range is
+// published again under the current generation, so positions of the kept
+// subtree are still found by transpositions reached in the new search.
+struct MCTSSubtreeCopy {
+    const MCTSArena& from;
+    MCTSArena& to;
+    SearchState& st;
+    Player cpu_player;
+    MCTSPosTable* table;
+    std::unordered_map<uint32_t, uint32_t> copied_ranges;
+
+    // Gives `d`, the copy of `s`, copies of s's children.
+    void children(uint32_t s, uint32_t d) {
+        const MCTSNode& s_node = from.nodes[s];
+        if (s_node.state.load(std::memory_order_relaxed) != MCTS_EXPANDED) return;
+        const uint16_t count = s_node.num_children;
+        uint32_t first = MCTS_NO_NODE;
+        if (count) {
+            auto it = copied_ranges.find(s_node.first_child);
+            if (it != copied_ranges.end()) {
+                first = it->second;
+            } else {
+                first = to.alloc(count);
+                if (first == MCTS_NO_NODE) return;
+                copied_ranges.emplace(s_node.first_child, first);
+                for (uint32_t i = 0; i < count; i++)
+                    to.nodes[first + i].copy_from(from.nodes[s_node.first_child + i]);
+                for (uint32_t i = 0; i < count; i++) {
+                    UndoMove u;
+                    if (!make_move_inplace(st, from.nodes[s_node.first_child + i].move(), cpu_player, u)) continue;
+                    children(s_node.first_child + i, first + i);
+                    unmake_move_inplace(st, u);
+                }
+            }
+            if (table) {
+                if (MCTSPosEntry* pe = table->find_or_insert(st.hash)) table->publish_range(*pe, first, count);
+            }
+        }
+        MCTSNode& d_node = to.nodes[d];
+        d_node.first_child = first;
+        d_node.num_children = count;
+        d_node.state.store(MCTS_EXPANDED, std::memory_order_relaxed);
+    }
+};
+
+static uint32_t mcts_copy_subtree(const MCTSArena& from, uint32_t src, MCTSArena& to,
+                                  SearchState& st, Player cpu_player, MCTSPosTable* table) {
+    uint32_t dst = to.alloc(1);
+    if (dst == MCTS_NO_NODE) return MCTS_NO_NODE;
+    to.nodes[dst].copy_from(from.nodes[src]);
+    MCTSSubtreeCopy copy{from, to, st, cpu_player, table, {}};
+    copy.children(src, dst);
+    return dst;
+}
+
+// ── Leaf-evaluation pipeline ──────────────────────────────────────────────
+// A selector walks the tree and queues leaves; evaluators drain the queue in
+// batches (AB value head + one batched static-eval call) and queue results
+// back for the selector to back up. Both queues are bounded lock-free MPMC
+// rings using per-cell sequence numbers (Vyukov), so neither side blocks the
+// other. Without threads one loop runs the stages in turn.
+struct MCTSLeaf {
+    uint32_t   path[MCTS_MAX_TREE_DEPTH]; // nodes below the root, root child first
+    int32_t    depth = 0;
+    int32_t    value = 0;                 // blended value, CPU perspective
+    bool       ok = false;                // false: aborted, roll back virtual loss
+    MoveTriple prev_move{};
+};
+
+template <typename T>
+struct MPMCRing {
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask = 0;
+    alignas(64) std::atomic<std::size_t> enqueue_pos{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos{0};
+
+    explicit MPMCRing(std::size_t min_capacity) {
+        std::size_t cap = 2;
+        while (cap < min_capacity) cap <<= 1;
+        cells.reset(new Cell[cap]);
+        mask = cap - 1;
+        for (std::size_t i = 0; i < cap; i++) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool try_push(const T& v) {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & mask];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & mask];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = c.value;
+                    c.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
     }
-    int visits_with_virtual_loss() const { return visits + virtual_loss; }
 };
 
 // ── Main MCTS+AB root search ──────────────────────────────────────────────
+// What the MCTS search knew about the move it returned, for the portfolio
+// referee.
+struct MCTSReport {
+    int8_t proof = MCTS_UNPROVEN; // of the chosen root child
+    int    visits = 0;            // of the chosen root child
+    int    root_visits = 0;
+    int    max_depth = 0;         // deepest selected path
+};
+
 static AIResult mcts_ab_root_search(const PieceList& pieces,
                                      Player cpu_player,
+                                     GameMode mode,
                                      int ab_depth,
                                      double time_limit_secs,
-                                     const std::atomic<bool>* stop_flag = nullptr) {
+                                     const std::atomic<bool>* stop_flag = nullptr,
+                                     int max_workers = 0,
+                                     MCTSReport* report = nullptr) {
+    if (report) *report = MCTSReport{};
     auto deadline = std::chrono::steady_clock::now() +
                     std::chrono::milliseconds((long long)(time_limit_secs * 1000));
     g_deadline = deadline;
@@ -4895,226 +6872,335 @@ static AIResult mcts_ab_root_search(const PieceList& pieces,
     reset_time_state();
     g_nodes.store(0, std::memory_order_relaxed);
 
-    SearchState root_st = make_search_state(pieces, cpu_player, cpu_player);
+    SearchState root_st = make_search_state(pieces, cpu_player, cpu_player, mode);
     const std::vector<uint64_t> game_rep_history_copy = g_game_rep_history;
     seed_search_hash_path_from_history(g_game_rep_history, root_st.hash);
     AllMoves all_moves  = all_moves_for(root_st.pieces, cpu_player);
     if (all_moves.empty()) return {false, {}};
     if (all_moves.size() == 1) return {true, all_moves[0]};
 
-    std::vector<float> root_priors =
-        mcts_policy_priors(all_moves, root_st.pieces, cpu_player);
-
-    std::vector<MCTSLevel1Child> children;
-    children.reserve(all_moves.size());
-    for (size_t i = 0; i < all_moves.size(); i++) {
-        MCTSLevel1Child c;
-        c.move  = all_moves[i];
-        c.prior = root_priors[i];
-        c.state = root_st;
-        UndoMove u;
-        if (!make_move_inplace(c.state, all_moves[i], cpu_player, u)) continue;
-        children.push_back(std::move(c));
-    }
-    if (children.empty()) return {false, {}};
+    std::lock_guard<EngineMutex> arena_lk(g_mcts_arena_mutex);
+    MCTSTree& tree = g_mcts_tree;
+    tree.resize(get_engine_config().mcts_arena_mb);
+    const bool share_positions = get_engine_config().mcts_transpositions;
+    const bool widen = get_engine_config().mcts_progressive_widening;
+    if (share_positions) tree.positions.next_generation();
+    const uint32_t reuse = mcts_find_reroot(tree, root_st, cpu_player, ab_depth);
+    MCTSArena& arena = tree.arenas[1 - tree.active];
+    arena.rewind();
+    uint32_t root = MCTS_NO_NODE;
+    if (reuse != MCTS_NO_NODE) {
+        SearchState copy_st = root_st;
+        root = mcts_copy_subtree(tree.arenas[tree.active], reuse, arena, copy_st, cpu_player,
+                                 share_positions ? &tree.positions : nullptr);
+    }
+    tree.arenas[tree.active].rewind();
+    tree.active = 1 - tree.active;
+    tree.root = MCTS_NO_NODE;
+    MCTSNode* nodes = arena.nodes.get();
+
+    // Grows the children of `idx`, whose position is `st`. Caller owns the
+    // node's EXPANDING state and publishes it afterwards. Terminal positions
+    // and a full arena leave the node without children.
+    auto expand = [&](uint32_t idx, SearchState& st) {
+        if (side_has_won(st.pieces, opp(st.turn), st.mode)) {
+            nodes[idx].prove(MCTS_PROVEN_WIN);
+            return;
+        }
+        MCTSPosEntry* pe = share_positions ? tree.positions.find_or_insert(st.hash) : nullptr;
+        if (pe) {
+            uint32_t shared_first = 0;
+            uint16_t shared_count = 0;
+            if (tree.positions.get_range(*pe, shared_first, shared_count)) {
+                nodes[idx].first_child = shared_first;
+                nodes[idx].num_children = shared_count;
+                return;
+            }
+        }
+        AllMoves moves = all_moves_for(st.pieces, st.turn);
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const MoveTriple& m) {
+            int pi = find_piece_idx_by_id_fast(st, m.pid);
+            return pi < 0 || !piece_move_is_pseudo_legal(st, st.pieces[pi], m.dc, m.dr);
+        }), moves.end());
+        if (moves.empty() || moves.size() > 0xFFFF) return;
+        uint32_t first = arena.alloc((uint32_t)moves.size());
+        if (first == MCTS_NO_NODE) return;
+        // Highest prior first, so progressive widening admits moves in
+        // policy order.
+        std::vector<float> priors = mcts_policy_priors(moves, st);
+        std::vector<uint16_t> order(moves.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = (uint16_t)i;
+        std::stable_sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) {
+            return priors[a] > priors[b];
+        });
+        for (size_t i = 0; i < moves.size(); i++) nodes[first + i].init(moves[order[i]], priors[order[i]]);
+        nodes[idx].first_child = first;
+        nodes[idx].num_children = (uint16_t)moves.size();
+        if (pe) tree.positions.publish_range(*pe, first, (uint16_t)moves.size());
+    };
 
-    struct SelectionPath {
-        int l1_idx = -1;
-        int l2_idx = -1;
-        SearchState eval_st;
-        MoveTriple prev_move{};
+    if (root == MCTS_NO_NODE) {
+        root = arena.alloc(1);
+        nodes[root].init(MoveTriple{-1, -1, -1}, 1.0f);
+        nodes[root].visits.store(1, std::memory_order_relaxed);
+    }
+    if (nodes[root].state.load(std::memory_order_relaxed) != MCTS_EXPANDED) {
+        expand(root, root_st);
+        nodes[root].state.store(MCTS_EXPANDED, std::memory_order_release);
+    }
+    const int root_children = nodes[root].num_children;
+    if (root_children == 0) return {false, {}};
+    tree.root = root;
+    tree.root_pieces = root_st.pieces;
+    tree.cpu_player = cpu_player;
+    tree.mode = root_st.mode;
+    tree.ab_depth = ab_depth;
+
+    // Each worker owns one position. Paths are walked down from the root
+    // with make/unmake and rewound afterwards, so no SearchState is copied
+    // per selection.
+    struct PathCursor {
+        SearchState st;
+        std::vector<UndoMove> undo;
+        int depth = 0;
+
+        bool push(const MoveTriple& m, Player cpu) {
+            if (depth == (int)undo.size()) undo.emplace_back();
+            if (!make_move_inplace(st, m, cpu, undo[(size_t)depth])) return false;
+            depth++;
+            return true;
+        }
+        void rewind() {
+            while (depth > 0) unmake_move_inplace(st, undo[(size_t)--depth]);
+        }
     };
 
-    int root_visits = 1;
-    EngineMutex tree_mutex;
-    Player opp_player = opp(cpu_player);
+    const bool use_webgpu = (active_eval_backend() == EvalBackendKind::WEBGPU);
+    const int eval_batch_size = std::max(1, std::min(
+        get_engine_config().mcts_eval_batch > 0 ? get_engine_config().mcts_eval_batch
+                                                : (use_webgpu ? MCTS_EVAL_BATCH_WEBGPU : MCTS_EVAL_BATCH_CPU),
+        root_children));
+
+    // Per-evaluator scratch: one position per batch slot so the whole batch
+    // is live for the batched static evaluator.
+    struct LeafEvaluator {
+        std::unique_ptr<ThreadData> td;
+        std::vector<PathCursor> slots;
+        std::vector<MCTSLeaf> leaves;
+    };
 
-    auto evaluate_leaf_value = [&](SelectionPath& sel, ThreadData* td, int* out_val) -> bool {
-        if (!out_val) return false;
-        int val = alphabeta(sel.eval_st, ab_depth, -999999, 999999,
-                            cpu_player, (sel.l2_idx >= 0 ? 2 : 1), true, &sel.prev_move, td);
-        if (time_up()) return false;
-        *out_val = val;
-        return true;
+    auto make_evaluator = [&](int tid) {
+        LeafEvaluator ev;
+        ev.td = std::make_unique<ThreadData>();
+        ev.td->thread_id = tid;
+        ev.td->reset();
+        ev.slots.resize((size_t)eval_batch_size);
+        for (auto& slot : ev.slots) {
+            slot.st = root_st;
+            slot.undo.reserve(MCTS_MAX_TREE_DEPTH);
+        }
+        ev.leaves.resize((size_t)eval_batch_size);
+        return ev;
     };
 
-    auto apply_leaf_result = [&](const SelectionPath& sel, float leaf_val) -> bool {
-        std::lock_guard<EngineMutex> lk(tree_mutex);
-        if (sel.l1_idx < 0 || sel.l1_idx >= (int)children.size()) return false;
-        MCTSLevel1Child& l1 = children[sel.l1_idx];
-        if (l1.virtual_loss > 0) l1.virtual_loss--;
+    // MCTS-Solver rule for an expanded node: a child won by the side to move
+    // here proves the node lost for its own mover; every child lost proves
+    // it won. Returns the node's proof afterwards.
+    auto settle_proof = [&](uint32_t idx) -> int8_t {
+        MCTSNode& n = nodes[idx];
+        int8_t pf = n.proven();
+        if (pf != MCTS_UNPROVEN) return pf;
+        if (n.state.load(std::memory_order_acquire) != MCTS_EXPANDED || n.num_children == 0) return pf;
+        bool all_lost = true;
+        for (uint32_t c = n.first_child; c < n.first_child + n.num_children; c++) {
+            int8_t cp = nodes[c].proven();
+            if (cp == MCTS_PROVEN_WIN) { n.prove(MCTS_PROVEN_LOSS); return n.proven(); }
+            if (cp != MCTS_PROVEN_LOSS) all_lost = false;
+        }
+        if (all_lost) n.prove(MCTS_PROVEN_WIN);
+        return n.proven();
+    };
 
-        if (sel.l2_idx >= 0 && sel.l2_idx < (int)l1.children.size()) {
-            MCTSLevel2Child& l2 = l1.children[sel.l2_idx];
-            if (l2.virtual_loss > 0) l2.virtual_loss--;
-            l2.visits++;
-            // Level-2 node is opponent-to-move; store from opponent perspective.
-            l2.total_value -= leaf_val;
-        }
+    // Leaf value, CPU perspective, of a proven node at path slot `depth - 1`.
+    auto proven_value = [&](int depth, int8_t pf) -> int {
+        int v = pf * MCTS_PROVEN_VALUE;
+        return ((depth - 1) % 2 == 0) ? v : -v;
+    };
 
-        l1.visits++;
-        l1.total_value += leaf_val;
-        root_visits++;
+    // Even path slots hold CPU moves, odd slots opponent replies; each node
+    // accumulates the leaf value from its mover's perspective.
+    auto apply_leaf_result = [&](const MCTSLeaf& sel, float leaf_val) -> bool {
+        if (sel.depth <= 0) return false;
+        for (int i = 0; i < sel.depth; i++) {
+            MCTSNode& n = nodes[sel.path[i]];
+            n.add_value((i % 2 == 0) ? leaf_val : -leaf_val);
+            n.visits.fetch_add(1, std::memory_order_relaxed);
+            n.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+        }
+        nodes[root].visits.fetch_add(1, std::memory_order_relaxed);
         return true;
     };
 
-    auto rollback_virtual_loss = [&](const SelectionPath& sel) {
-        std::lock_guard<EngineMutex> lk(tree_mutex);
-        if (sel.l1_idx < 0 || sel.l1_idx >= (int)children.size()) return;
-        MCTSLevel1Child& l1 = children[sel.l1_idx];
-        if (l1.virtual_loss > 0) l1.virtual_loss--;
-        if (sel.l2_idx >= 0 && sel.l2_idx < (int)l1.children.size()) {
-            MCTSLevel2Child& l2 = l1.children[sel.l2_idx];
-            if (l2.virtual_loss > 0) l2.virtual_loss--;
-        }
+    auto rollback_virtual_loss = [&](const MCTSLeaf& sel) {
+        for (int i = 0; i < sel.depth; i++)
+            nodes[sel.path[i]].virtual_loss.fetch_sub(1, std::memory_order_relaxed);
     };
 
-    auto select_path = [&](SelectionPath& sel) -> bool {
-        std::lock_guard<EngineMutex> lk(tree_mutex);
-        if (children.empty()) return false;
-
-        float sqrt_root = std::sqrt((float)std::max(1, root_visits));
-        int l1_idx = 0;
-        float best_puct = -1e18f;
-        for (int i = 0; i < (int)children.size(); i++) {
-            auto& c = children[i];
-            float q = c.q_with_virtual_loss();
-            float u = MCTS_CPUCT * c.prior * sqrt_root /
-                      (1.0f + (float)c.visits_with_virtual_loss());
-            float puct = q + u;
-            if (puct > best_puct) { best_puct = puct; l1_idx = i; }
-        }
-
-        MCTSLevel1Child& l1 = children[l1_idx];
-        l1.virtual_loss++;
-        sel.l1_idx = l1_idx;
-        sel.eval_st = l1.state;
-        sel.prev_move = l1.move;
-
-        if (l1.visits >= 2) {
-            if (!l1.expanded) {
-                l1.expanded = true;
-                AllMoves l2_moves = all_moves_for(l1.state.pieces, opp_player);
-                std::vector<float> l2_priors =
-                    mcts_policy_priors(l2_moves, l1.state.pieces, opp_player);
-                l1.children.reserve(l2_moves.size());
-                for (size_t j = 0; j < l2_moves.size(); j++) {
-                    MCTSLevel2Child c2;
-                    c2.move  = l2_moves[j];
-                    c2.prior = l2_priors[j];
-                    c2.state = l1.state;
-                    UndoMove u2;
-                    if (!make_move_inplace(c2.state, l2_moves[j], opp_player, u2)) continue;
-                    l1.children.push_back(std::move(c2));
+    auto select_path = [&](MCTSLeaf& sel, PathCursor& pos) -> bool {
+        sel.depth = 0;
+        sel.value = 0;
+        sel.ok = false;
+        sel.prev_move = MoveTriple{};
+
+        // DAG mode can loop back to a position already on the path; such a
+        // repetition ends the walk as a leaf.
+        uint64_t path_hash[MCTS_MAX_TREE_DEPTH + 1];
+        path_hash[0] = pos.st.hash;
+
+        uint32_t cur = root;
+        while (sel.depth < MCTS_MAX_TREE_DEPTH) {
+            MCTSNode& n = nodes[cur];
+            if (n.proven() != MCTS_UNPROVEN) break; // exact value, nothing to search
+            uint8_t state = n.state.load(std::memory_order_acquire);
+            if (state == MCTS_LEAF && n.visits.load(std::memory_order_relaxed) >= MCTS_EXPAND_VISITS) {
+                if (n.state.compare_exchange_strong(state, MCTS_EXPANDING, std::memory_order_acquire)) {
+                    expand(cur, pos.st);
+                    n.state.store(MCTS_EXPANDED, std::memory_order_release);
+                    state = MCTS_EXPANDED;
                 }
             }
-
-            if (!l1.children.empty()) {
-                float sqrt_l1 = std::sqrt((float)std::max(1, l1.visits_with_virtual_loss()));
-                int l2_idx = 0;
-                float best_puct2 = -1e18f;
-                for (int j = 0; j < (int)l1.children.size(); j++) {
-                    auto& c2 = l1.children[j];
-                    float q2 = c2.q_with_virtual_loss();
-                    float u2 = MCTS_CPUCT * c2.prior * sqrt_l1 /
-                               (1.0f + (float)c2.visits_with_virtual_loss());
-                    // q2 is stored from opponent perspective at level-2.
-                    float puct2 = q2 + u2;
-                    if (puct2 > best_puct2) { best_puct2 = puct2; l2_idx = j; }
+            if (state != MCTS_EXPANDED || n.num_children == 0) break;
+            if (settle_proof(cur) != MCTS_UNPROVEN) break;
+
+            // Lost children are skipped and do not use up widening slots.
+            float sqrt_n = std::sqrt((float)std::max(1, n.visits_with_virtual_loss()));
+            uint32_t width = n.num_children;
+            if (widen) width = std::min(width, (uint32_t)(MCTS_WIDEN_BASE + MCTS_WIDEN_SCALE * sqrt_n));
+            uint32_t best = MCTS_NO_NODE;
+            float best_puct = -1e18f;
+            for (uint32_t c = n.first_child; c < n.first_child + width; c++) {
+                const MCTSNode& ch = nodes[c];
+                if (ch.proven() == MCTS_PROVEN_LOSS) {
+                    if (width < n.num_children) width++;
+                    continue;
                 }
-                MCTSLevel2Child& l2 = l1.children[l2_idx];
-                l2.virtual_loss++;
-                sel.l2_idx = l2_idx;
-                sel.eval_st = l2.state;
-                sel.prev_move = l2.move;
+                float u = MCTS_CPUCT * ch.prior * sqrt_n /
+                          (1.0f + (float)ch.visits_with_virtual_loss());
+                float puct = ch.q_with_virtual_loss() + u;
+                if (puct > best_puct) { best_puct = puct; best = c; }
+            }
+            if (best == MCTS_NO_NODE) break;
+
+            if (!pos.push(nodes[best].move(), cpu_player)) break;
+            nodes[best].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+            sel.path[sel.depth++] = best;
+            sel.prev_move = nodes[best].move();
+            cur = best;
+            if (share_positions) {
+                path_hash[sel.depth] = pos.st.hash;
+                if (std::find(path_hash, path_hash + sel.depth, pos.st.hash) != path_hash + sel.depth) break;
             }
         }
-        return true;
+        pos.rewind();
+        return sel.depth > 0;
     };
 
-    auto worker = [&](int tid) {
-        g_deadline = deadline;
-        g_stop_flag = stop_flag;
-        g_game_rep_history = game_rep_history_copy;
-        seed_search_hash_path_from_history(g_game_rep_history, root_st.hash);
-        reset_time_state();
-
-        auto td_ptr = std::make_unique<ThreadData>();
-        td_ptr->thread_id = tid;
-        td_ptr->reset();
-        ThreadData& td = *td_ptr;
-
-        const bool use_webgpu = (active_eval_backend() == EvalBackendKind::WEBGPU);
-        int eval_batch_size = use_webgpu ? MCTS_EVAL_BATCH_WEBGPU : MCTS_EVAL_BATCH_CPU;
-        eval_batch_size = std::max(1, std::min(eval_batch_size, (int)children.size()));
-
-        while (!time_up()) {
-            if (stop_flag && stop_flag->load(std::memory_order_relaxed)) break;
-
-            std::vector<SelectionPath> selected;
-            selected.reserve((size_t)eval_batch_size);
-            for (int i = 0; i < eval_batch_size && !time_up(); i++) {
-                SelectionPath sel;
-                if (!select_path(sel)) break;
-                selected.push_back(std::move(sel));
+    // Evaluates up to one batch from `leaf_queue` and queues the results.
+    // Returns the number of leaves taken.
+    auto evaluate_batch = [&](LeafEvaluator& ev, MPMCRing<MCTSLeaf>& leaf_queue,
+                              MPMCRing<MCTSLeaf>& done_queue) -> int {
+        int n = 0;
+        while (n < eval_batch_size && leaf_queue.try_pop(ev.leaves[(size_t)n])) n++;
+        if (n == 0) return 0;
+
+        std::vector<EvalBatchRequest> reqs;
+        std::vector<int> req_idx;
+        std::vector<MCTSPosEntry*> req_entry;
+        reqs.reserve((size_t)n);
+        req_idx.reserve((size_t)n);
+        req_entry.reserve((size_t)n);
+        for (int i = 0; i < n; i++) {
+            MCTSLeaf& leaf = ev.leaves[(size_t)i];
+            PathCursor& cur = ev.slots[(size_t)i];
+            leaf.ok = false;
+            MCTSNode& leaf_node = nodes[leaf.path[leaf.depth - 1]];
+            if (int8_t pf = leaf_node.proven()) {
+                leaf.value = proven_value(leaf.depth, pf);
+                leaf.ok = true;
+                continue;
             }
-            if (selected.empty()) break;
-
-            std::vector<int> values(selected.size(), 0);
-            std::vector<uint8_t> ok(selected.size(), 0);
-            for (size_t i = 0; i < selected.size(); i++) {
-                int val = 0;
-                if (evaluate_leaf_value(selected[i], &td, &val)) {
-                    values[i] = val;
-                    ok[i] = 1;
-                }
+            // A decisive value-head score proves the leaf for its mover.
+            auto prove_if_decisive = [&](int value) -> bool {
+                if (std::abs(value) < MCTS_DECISIVE_SCORE) return false;
+                int mover_value = ((leaf.depth - 1) % 2 == 0) ? value : -value;
+                leaf_node.prove(mover_value > 0 ? MCTS_PROVEN_WIN : MCTS_PROVEN_LOSS);
+                return true;
+            };
+            bool replayed = true;
+            for (int d = 0; d < leaf.depth && replayed; d++)
+                replayed = cur.push(nodes[leaf.path[d]].move(), cpu_player);
+            if (!replayed || time_up()) continue;
+            MCTSPosEntry* pe = share_positions ? tree.positions.find_or_insert(cur.st.hash) : nullptr;
+            if (pe && tree.positions.get_value(*pe, leaf.value)) {
+                prove_if_decisive(leaf.value);
+                leaf.ok = true;
+                continue;
             }
-
-            // Node queue batching path: blend AB leaf values with batched evaluator scores.
-            std::vector<EvalBatchRequest> reqs;
-            std::vector<size_t> req_idx;
-            reqs.reserve(selected.size());
-            req_idx.reserve(selected.size());
-            for (size_t i = 0; i < selected.size(); i++) {
-                if (!ok[i]) continue;
-                ensure_attack_cache(selected[i].eval_st);
-                reqs.push_back(EvalBatchRequest{
-                    &selected[i].eval_st.pieces,
-                    &cpu_player,
-                    &selected[i].eval_st.atk,
-                    &selected[i].eval_st.turn
-                });
-                req_idx.push_back(i);
+            int leaf_ply = std::min(leaf.depth, MCTS_LEAF_PLY_CAP);
+            leaf.value = alphabeta(cur.st, ab_depth, -999999, 999999,
+                                   cpu_player, leaf_ply, true, &leaf.prev_move, ev.td.get());
+            if (time_up()) continue;
+            leaf.ok = true;
+            if (prove_if_decisive(leaf.value)) {
+                if (pe) tree.positions.put_value(*pe, leaf.value);
+                continue;
             }
-            if (!reqs.empty()) {
-                std::vector<int> batch_scores = board_score_batch(reqs);
-                size_t n = std::min(batch_scores.size(), req_idx.size());
-                for (size_t j = 0; j < n; j++) {
-                    size_t idx = req_idx[j];
-                    if (use_webgpu) values[idx] = (values[idx] * 3 + batch_scores[j]) / 4;
-                    else            values[idx] = (values[idx] * 7 + batch_scores[j]) / 8;
-                }
+            ensure_attack_cache(cur.st);
+            reqs.push_back(EvalBatchRequest{&cur.st.pieces, &cpu_player, &cur.st.atk, &cur.st.turn});
+            req_idx.push_back(i);
+            req_entry.push_back(pe);
+        }
+        if (!reqs.empty()) {
+            std::vector<int> batch_scores = board_score_batch(reqs);
+            size_t m = std::min(batch_scores.size(), req_idx.size());
+            for (size_t j = 0; j < m; j++) {
+                MCTSLeaf& leaf = ev.leaves[(size_t)req_idx[j]];
+                leaf.value = use_webgpu ? (leaf.value * 3 + batch_scores[j]) / 4
+                                        : (leaf.value * 7 + batch_scores[j]) / 8;
+                if (req_entry[j]) tree.positions.put_value(*req_entry[j], leaf.value);
             }
+        }
+        for (int i = 0; i < n; i++) {
+            ev.slots[(size_t)i].rewind();
+            while (!done_queue.try_push(ev.leaves[(size_t)i])) std::this_thread::yield();
+        }
+        return n;
+    };
 
-            bool any_applied = false;
-            for (size_t i = 0; i < selected.size(); i++) {
-                if (!ok[i]) {
-                    rollback_virtual_loss(selected[i]);
-                    continue;
-                }
-                float leaf_val = std::max(-1.0f, std::min(1.0f, (float)values[i] / 6000.0f));
-                if (apply_leaf_result(selected[i], leaf_val)) {
-                    any_applied = true;
-                } else {
-                    rollback_virtual_loss(selected[i]);
-                }
-            }
-            if (!any_applied && time_up()) {
-                break;
-            }
+    auto back_up = [&](const MCTSLeaf& leaf) {
+        if (!leaf.ok) { rollback_virtual_loss(leaf); return; }
+        float leaf_val = std::max(-1.0f, std::min(1.0f, (float)leaf.value / 6000.0f));
+        if (!apply_leaf_result(leaf, leaf_val)) { rollback_virtual_loss(leaf); return; }
+        // Carry a proof upwards for as long as it settles each parent.
+        if (nodes[leaf.path[leaf.depth - 1]].proven() == MCTS_UNPROVEN) return;
+        for (int i = leaf.depth - 1; i >= 0; i--) {
+            uint32_t parent = i > 0 ? leaf.path[i - 1] : root;
+            if (settle_proof(parent) == MCTS_UNPROVEN) break;
         }
     };
 
+    auto enter_search_thread = [&]() {
+        g_deadline = deadline;
+        g_stop_flag = stop_flag;
+        g_game_rep_history = game_rep_history_copy;
+        seed_search_hash_path_from_history(g_game_rep_history, root_st.hash);
+        reset_time_state();
+    };
+    auto stopped = [&]() {
+        return time_up() || (stop_flag && stop_flag->load(std::memory_order_relaxed)) ||
+               nodes[root].proven() != MCTS_UNPROVEN;
+    };
+
     int num_workers = 1;
 #if COMMANDER_ENABLE_THREADS
     if (!get_engine_config().force_single_thread) {
@@ -5123,45 +7209,124 @@ static AIResult mcts_ab_root_search(const PieceList& pieces,
         num_workers = std::max(1, std::min(hw_threads, MCTS_MAX_THREADS));
     }
 #endif
-    if (time_limit_secs <= 0.10 || (int)children.size() <= 2) num_workers = 1;
+    if (max_workers > 0) num_workers = std::min(num_workers, max_workers);
+    if (time_limit_secs <= 0.10 || root_children <= 2) num_workers = 1;
+
+    // One selector plus (num_workers - 1) evaluators. The selector evaluates
+    // a batch itself whenever it cannot queue another leaf, so every worker
+    // runs the value head; with a single worker it evaluates inline.
+    const int num_evaluators = num_workers > 1 ? num_workers - 1 : 0;
+    const int max_in_flight = eval_batch_size * std::max(1, num_evaluators) * 2;
+    MPMCRing<MCTSLeaf> leaf_queue((size_t)max_in_flight);
+    MPMCRing<MCTSLeaf> done_queue((size_t)max_in_flight);
+    int in_flight = 0; // selector-owned
+    int max_sel_depth = 0; // selector-owned
+    std::atomic<bool> selection_done{false};
+
+    auto drain_done = [&]() {
+        MCTSLeaf leaf;
+        while (done_queue.try_pop(leaf)) {
+            in_flight--;
+            back_up(leaf);
+        }
+    };
 
-    if (num_workers == 1) {
-        worker(0);
+    enter_search_thread();
+    PathCursor pos;
+    pos.st = root_st;
+    pos.undo.reserve(MCTS_MAX_TREE_DEPTH);
+    MCTSLeaf leaf;
+
+    if (num_evaluators == 0) {
+        LeafEvaluator ev = make_evaluator(0);
+        while (!stopped()) {
+            int queued = 0;
+            while (queued < eval_batch_size && !time_up() && select_path(leaf, pos)) {
+                max_sel_depth = std::max(max_sel_depth, (int)leaf.depth);
+                leaf_queue.try_push(leaf);
+                queued++;
+            }
+            in_flight += queued;
+            if (queued == 0) break;
+            evaluate_batch(ev, leaf_queue, done_queue);
+            drain_done();
+        }
     } else {
 #if COMMANDER_ENABLE_THREADS
+        auto evaluator = [&](int tid) {
+            enter_search_thread();
+            LeafEvaluator ev = make_evaluator(tid);
+            while (true) {
+                if (evaluate_batch(ev, leaf_queue, done_queue) > 0) continue;
+                if (selection_done.load(std::memory_order_acquire)) break;
+                std::this_thread::yield();
+            }
+        };
         std::vector<std::thread> threads;
-        threads.reserve(num_workers);
-        for (int i = 0; i < num_workers; i++) threads.emplace_back(worker, i);
+        threads.reserve((size_t)num_evaluators);
+        for (int i = 0; i < num_evaluators; i++) threads.emplace_back(evaluator, i + 1);
+
+        LeafEvaluator sel_ev = make_evaluator(0);
+        while (!stopped()) {
+            drain_done();
+            if (in_flight < max_in_flight && select_path(leaf, pos)) {
+                max_sel_depth = std::max(max_sel_depth, (int)leaf.depth);
+                leaf_queue.try_push(leaf);
+                in_flight++;
+                continue;
+            }
+            // Queue full (or nothing selectable): help the evaluators rather
+            // than spin. done_queue holds in_flight <= its capacity, so the
+            // push inside evaluate_batch cannot block on the selector.
+            if (evaluate_batch(sel_ev, leaf_queue, done_queue) > 0) continue;
+            std::this_thread::yield();
+        }
+        selection_done.store(true, std::memory_order_release);
         for (auto& t : threads) if (t.joinable()) t.join();
-#else
-        worker(0);
 #endif
     }
 
-    int best_idx = 0;
+    // Settle everything still queued so the kept tree has no stray virtual loss.
+    while (leaf_queue.try_pop(leaf)) { rollback_virtual_loss(leaf); in_flight--; }
+    drain_done();
+
+    // A proven win beats any visit count and a proven loss is only played
+    // when nothing else is left.
+    uint32_t best_idx = nodes[root].first_child;
+    int best_proof = MCTS_PROVEN_LOSS - 1;
     int best_visits = -1;
     float best_q = -1e18f;
-    for (int i = 0; i < (int)children.size(); i++) {
-        const auto& c = children[i];
-        if (c.visits > best_visits ||
-            (c.visits == best_visits && c.q() > best_q)) {
-            best_visits = c.visits;
+    for (uint32_t i = nodes[root].first_child; i < nodes[root].first_child + (uint32_t)root_children; i++) {
+        const MCTSNode& c = nodes[i];
+        int pf = c.proven();
+        int v = c.visits.load(std::memory_order_relaxed);
+        if (pf > best_proof ||
+            (pf == best_proof && (v > best_visits ||
+                                  (v == best_visits && c.q() > best_q)))) {
+            best_proof = pf;
+            best_visits = v;
             best_q = c.q();
             best_idx = i;
         }
     }
 
-    if (best_visits <= 0) return {false, {}};
-    return {true, children[best_idx].move};
+    if (best_visits <= 0 && best_proof != MCTS_PROVEN_WIN) return {false, {}};
+    if (report) {
+        report->proof = (int8_t)best_proof;
+        report->visits = best_visits;
+        report->root_visits = nodes[root].visits.load(std::memory_order_relaxed);
+        report->max_depth = max_sel_depth;
+    }
+    return {true, nodes[best_idx].move()};
 }
 
+
 static bool is_legal_book_move(const SearchState& st, Player cpu_player, const MoveTriple& cand) {
     int idx = find_piece_idx_by_id_fast(st, cand.pid);
     if (idx < 0) return false;
     const Piece& p = st.pieces[idx];
     if (p.player != cpu_player) return false;
-    MoveGenContext ctx = build_movegen_context(st.pieces);
-    return has_legal_destination_with_ctx(p, ctx, cand.dc, cand.dr);
+    return piece_move_is_pseudo_legal(st, p, cand.dc, cand.dr);
 }
 
 static void append_book_move_from_square(std::vector<MoveTriple>& book,
@@ -5256,7 +7421,7 @@ static bool opening_book_pick(const SearchState& st, Player cpu_player, MoveTrip
     for (auto& m : book) {
         if (!is_legal_book_move(st, cpu_player, m)) continue;
         PieceList np = apply_move(st.pieces, m.pid, m.dc, m.dr, cpu_player);
-        if (has_immediate_winning_move(np, opp(cpu_player))) continue;
+        if (has_immediate_winning_move(np, opp(cpu_player), st.mode)) continue;
         int risk = opening_immediate_risk(np, cpu_player);
         if (risk >= 1000000) continue; // never allow immediate commander hangs
         int score = board_score(np, cpu_player, nullptr, &stm_after) - risk;
@@ -5266,11 +7431,365 @@ static bool opening_book_pick(const SearchState& st, Player cpu_player, MoveTrip
             found = true;
         }
     }
-    if (found) { out = best; return true; }
-    return false;
-}
+    if (found) { out = best; return true; }
+    return false;
+}
+
+// ── Binary opening book ───────────────────────────────────────────────────
+// Built offline by `--book-gen` from deep self-play searches. The file is a
+// 32-byte header followed by 16-byte entries sorted by key (then weight,
+// descending); lookup is a binary search over the mapped file. Keys are the
+// plain Zobrist hash of (pieces, side to move) salted per GameMode; moves are
+// stored as (from square, piece kind, to square) so they survive id changes.
+static const char BOOK_MAGIC[8] = {'C', 'C', 'B', 'O', 'O', 'K', '0', '1'};
+
+struct BookFileHeader {
+    char magic[8];
+    uint64_t entries;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(BookFileHeader) == 32, "book header must stay 32 bytes");
+
+struct BookEntry {
+    uint64_t key;
+    uint8_t from_sq;
+    uint8_t to_sq;
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t weight;
+    uint16_t reserved2;
+};
+static_assert(sizeof(BookEntry) == 16, "book entry must stay 16 bytes");
+
+struct OpeningBook {
+    MappedFile file;
+    const BookEntry* entries = nullptr;
+    std::size_t count = 0;
+
+    bool attach() {
+        BookFileHeader hdr{};
+        if (file.size < sizeof(hdr)) return false;
+        std::memcpy(&hdr, file.data, sizeof(hdr));
+        if (std::memcmp(hdr.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0) return false;
+        if ((file.size - sizeof(hdr)) / sizeof(BookEntry) < hdr.entries) return false;
+        entries = reinterpret_cast<const BookEntry*>(file.data + sizeof(hdr));
+        count = (std::size_t)hdr.entries;
+        return true;
+    }
+};
+
+static EngineMutex g_book_mutex;
+// Shared so a search still probing a book outlives its replacement.
+static std::shared_ptr<const OpeningBook> g_book;
+static bool g_book_tried = false;
+
+static inline uint64_t book_key(const PieceList& pieces, Player turn, GameMode mode) {
+    static const uint64_t kModeSalt[4] = {0, 0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL};
+    return zobrist_hash(pieces, turn) ^ kModeSalt[(int)mode];
+}
+
+// Loaded book, or nullptr. The configured file is opened on first use.
+static std::shared_ptr<const OpeningBook> book_get() {
+    std::lock_guard<EngineMutex> lk(g_book_mutex);
+    if (!g_book_tried) {
+        g_book_tried = true;
+        const std::string& path = get_engine_config().opening_book_path;
+        auto book = std::make_unique<OpeningBook>();
+        if (!path.empty() && book->file.open(path) && book->attach()) g_book = std::move(book);
+    }
+    return g_book;
+}
+
+// Highest-weight legal book move for the side to move in `st`.
+static bool book_probe(const OpeningBook& book, const SearchState& st, Player cpu_player, MoveTriple& out) {
+    const uint64_t key = book_key(st.pieces, cpu_player, st.mode);
+    const BookEntry* first = std::lower_bound(book.entries, book.entries + book.count, key,
+                                              [](const BookEntry& e, uint64_t k) { return e.key < k; });
+    for (const BookEntry* e = first; e != book.entries + book.count && e->key == key; ++e) {
+        int fc = sq_col(e->from_sq), fr = sq_row(e->from_sq);
+        for (const auto& p : st.pieces) {
+            if (p.player != cpu_player || p.col != fc || p.row != fr || (int)p.kind != e->kind) continue;
+            MoveTriple m{p.id, sq_col(e->to_sq), sq_row(e->to_sq)};
+            if (is_legal_book_move(st, cpu_player, m)) { out = m; return true; }
+        }
+    }
+    return false;
+}
+
+// Book move for the root: the binary book when one is loaded, otherwise the
+// built-in opening heuristics.
+static bool book_pick(const SearchState& st, Player cpu_player, MoveTriple& out) {
+    if (!g_use_opening_book) return false;
+    if (std::shared_ptr<const OpeningBook> book = book_get()) return book_probe(*book, st, cpu_player, out);
+    return opening_book_pick(st, cpu_player, out);
+}
+
+// ── Proof-number solver (variant objectives) ──────────────────────────────
+// Depth-first proof-number search (df-pn) run at the root of late Marine /
+// Air / Land battle positions. It answers "can `attacker` force check_win()
+// within N plies" under the search's game mode. Proofs are sound; disproofs
+// are only "no win within the ply limit" (cycles and the horizon count as
+// disproven), so a loss is established by proving the opponent's win.
+static const uint32_t PN_INF = 100000000u;
+
+struct PNEntry {
+    uint64_t key = 0;
+    uint32_t pn = 1, dn = 1;
+    int16_t depth = 0; // remaining plies the (dis)proof was computed with
+};
+
+struct PNSolver {
+    std::vector<PNEntry> table;
+    std::size_t mask = 0;
+    Player attacker = Player::Red;
+    Player cpu_player = Player::Red;
+    uint64_t salt = 0;
+    uint64_t nodes = 0;
+    uint64_t budget = 0;
+    std::chrono::steady_clock::time_point deadline;
+    bool aborted = false;
+    std::vector<uint64_t> path;
+
+    explicit PNSolver(int log2_entries) {
+        table.resize((std::size_t)1 << log2_entries);
+        mask = table.size() - 1;
+    }
+
+    uint64_t key_of(const SearchState& st) const { return st.hash ^ salt; }
+
+    void lookup(uint64_t key, int depth, uint32_t& pn, uint32_t& dn) const {
+        const PNEntry& e = table[key & mask];
+        pn = 1; dn = 1;
+        if (e.key != key) return;
+        // A proof holds at any depth; a disproof only up to the depth it saw.
+        if (e.dn == 0 && e.depth < depth) return;
+        pn = e.pn; dn = e.dn;
+    }
+
+    void store(uint64_t key, int depth, uint32_t pn, uint32_t dn) {
+        PNEntry& e = table[key & mask];
+        if (e.key == key && e.pn == 0 && pn != 0) return; // keep proofs
+        e.key = key; e.pn = pn; e.dn = dn; e.depth = (int16_t)depth;
+    }
+
+    bool out_of_budget() {
+        if (aborted) return true;
+        if (nodes >= budget) aborted = true;
+        else if ((nodes & 255) == 0 && std::chrono::steady_clock::now() > deadline) aborted = true;
+        return aborted;
+    }
+
+    struct Child {
+        MoveTriple move;
+        uint64_t key = 0;
+        bool terminal = false;   // decided by check_win() or the ply limit
+        uint32_t pn = 1, dn = 1; // fixed values when terminal
+    };
+
+    // Expands `st` (side to move = st.turn) and classifies every child.
+    void expand(SearchState& st, int depth, std::vector<Child>& kids) {
+        AllMoves moves = all_moves_for(st.pieces, st.turn);
+        kids.clear();
+        kids.reserve(moves.size());
+        Player mover = st.turn;
+        for (const auto& m : moves) {
+            UndoMove u;
+            if (!make_move_inplace_search(st, m, cpu_player, u)) continue;
+            Child c;
+            c.move = m;
+            c.key = key_of(st);
+            if (side_has_won(st.pieces, mover, st.mode)) {
+                c.terminal = true;
+                bool att_wins = (mover == attacker);
+                c.pn = att_wins ? 0 : PN_INF;
+                c.dn = att_wins ? PN_INF : 0;
+            } else if (depth <= 1 ||
+                       std::find(path.begin(), path.end(), c.key) != path.end()) {
+                c.terminal = true;
+                c.pn = PN_INF; c.dn = 0;
+            }
+            unmake_move_inplace(st, u);
+            kids.push_back(c);
+        }
+    }
+
+    void mid(SearchState& st, uint32_t thpn, uint32_t thdn, int depth) {
+        nodes++;
+        uint64_t key = key_of(st);
+        std::vector<Child> kids;
+        expand(st, depth, kids);
+        const bool or_node = (st.turn == attacker);
+        path.push_back(key);
+
+        uint32_t pn = 0, dn = 0;
+        while (true) {
+            // Aggregate children: OR = min pn / sum dn, AND = sum pn / min dn.
+            uint32_t best_a = PN_INF, second_a = PN_INF, sum_b = 0;
+            int best_i = -1;
+            uint32_t best_b = 0;
+            for (int i = 0; i < (int)kids.size(); i++) {
+                uint32_t cpn = kids[i].pn, cdn = kids[i].dn;
+                if (!kids[i].terminal) lookup(kids[i].key, depth - 1, cpn, cdn);
+                uint32_t a = or_node ? cpn : cdn;
+                uint32_t b = or_node ? cdn : cpn;
+                sum_b = std::min(PN_INF, sum_b + b);
+                if (a < best_a) { second_a = best_a; best_a = a; best_i = i; best_b = b; }
+                else if (a < second_a) second_a = a;
+            }
+            pn = or_node ? best_a : sum_b;
+            dn = or_node ? sum_b : best_a;
+            // No legal moves is not a win for either side (alpha-beta falls
+            // back to the static eval, the tablebases call it a draw), so it
+            // is disproven at OR and AND nodes alike.
+            if (kids.empty()) { pn = PN_INF; dn = 0; }
+            if (pn >= thpn || dn >= thdn || pn == 0 || dn == 0) break;
+            if (out_of_budget()) break;
+
+            // Child thresholds (Nagai): tighten the "min" side by the runner-up.
+            uint32_t th_a = or_node ? thpn : thdn;
+            uint32_t th_b = or_node ? thdn : thpn;
+            uint32_t sum_b_now = or_node ? dn : pn;
+            uint32_t child_a = std::min(th_a, second_a == PN_INF ? PN_INF : second_a + 1);
+            uint32_t child_b = (th_b >= PN_INF) ? PN_INF : th_b - sum_b_now + best_b;
+            const Child& c = kids[(std::size_t)best_i];
+            UndoMove u;
+            if (!make_move_inplace_search(st, c.move, cpu_player, u)) break;
+            if (or_node) mid(st, child_a, child_b, depth - 1);
+            else         mid(st, child_b, child_a, depth - 1);
+            unmake_move_inplace(st, u);
+        }
+        path.pop_back();
+        if (!aborted || pn == 0 || dn == 0) store(key, depth, pn, dn);
+    }
+
+    // Proves a forced win for `att` within `max_ply` plies from `st`.
+    bool prove(SearchState& st, Player att, int max_ply) {
+        attacker = att;
+        salt = (att == Player::Red) ? 0x5D1F0C3A9B7E2461ULL : 0xA2E0F3C56481D79BULL;
+        for (int d = 1; d <= max_ply && !aborted; d++) {
+            if (((st.turn == att) ? d : d + 1) % 2 == 0) continue; // wins land on attacker plies
+            mid(st, PN_INF - 1, PN_INF - 1, d);
+            uint32_t pn, dn;
+            lookup(key_of(st), d, pn, dn);
+            if (pn == 0) return true;
+        }
+        return false;
+    }
+};
+
+static bool pn_solver_applicable(const PieceList& pieces, GameMode mode) {
+    if (mode == GameMode::FULL_BATTLE) return false;
+    int active = 0;
+    for (const auto& p : pieces)
+        if (on_board(p.col, p.row) && p.kind != PieceKind::HQ) active++;
+    return active <= 16;
+}
+
+// Root entry: +1 = proven win (out = winning move), -1 = proven loss
+// (out = a move that avoids an immediate loss where possible), 0 = unknown.
+static int pn_solve_root(const PieceList& pieces, Player cpu_player, GameMode mode,
+                         double time_limit_secs, MoveTriple& out) {
+    const EngineConfig& cfg = get_engine_config();
+    if (cfg.pns_node_budget <= 0 || !pn_solver_applicable(pieces, mode)) return 0;
+
+    static const int PN_MAX_PLY = 7;
+    PNSolver solver(16);
+    solver.cpu_player = cpu_player;
+    solver.budget = (uint64_t)cfg.pns_node_budget;
+    // Never spend more than a tenth of the move's time proving.
+    solver.deadline = std::chrono::steady_clock::now() +
+                      std::chrono::milliseconds(std::max(1, (int)(time_limit_secs * 100)));
+    SearchState st = make_search_state(pieces, cpu_player, cpu_player, mode);
+
+    if (solver.prove(st, cpu_player, PN_MAX_PLY)) {
+        std::vector<PNSolver::Child> kids;
+        solver.expand(st, PN_MAX_PLY, kids);
+        for (const auto& c : kids) {
+            uint32_t pn = c.pn, dn = c.dn;
+            if (!c.terminal) solver.lookup(c.key, 0, pn, dn);
+            if (pn == 0) { out = c.move; return 1; }
+        }
+        return 0;
+    }
+    if (solver.aborted) return 0;
+
+    if (solver.prove(st, opp(cpu_player), PN_MAX_PLY + 1)) {
+        // Every move loses; prefer one that doesn't hand over the win at once.
+        AllMoves moves = order_moves(all_moves_for(st.pieces, cpu_player), st.pieces,
+                                     cpu_player, 0, nullptr);
+        if (moves.empty()) return 0;
+        out = moves[0];
+        for (const auto& m : moves) {
+            PieceList np = apply_move(st.pieces, m.pid, m.dc, m.dr, cpu_player);
+            if (!has_immediate_winning_move(np, opp(cpu_player), st.mode)) { out = m; break; }
+        }
+        return -1;
+    }
+    return 0;
+}
+
+// ── Root move table ───────────────────────────────────────────────────────
+// Persistent per-root-move record kept across iterations and aspiration
+// re-searches. Moves are scored by order_moves() once, then reordered only
+// by their last search result, so the root never re-runs SEE/history scoring.
+// Subtree node counts give time management the best move's effort share.
+struct RootMove {
+    MoveTriple move{};
+    int score      = -999999;  // style-adjusted rank from the latest search
+    int prev_score = -999999;  // rank at the end of the previous iteration
+    uint64_t nodes = 0;        // subtree nodes, accumulated over iterations
+};
+
+struct RootMoveTable {
+    std::vector<RootMove> moves;
+    uint64_t total_nodes = 0;
+
+    void init(const AllMoves& all, const PieceList& pieces, Player player, ThreadData* td) {
+        AllMoves ordered = order_moves(all, pieces, player, 0, nullptr, nullptr, nullptr, td);
+        moves.clear();
+        moves.resize(ordered.size());
+        for (std::size_t i = 0; i < ordered.size(); i++) moves[i].move = ordered[i];
+        total_nodes = 0;
+    }
+
+    // Called at the start of each iteration.
+    void new_iteration() {
+        for (auto& rm : moves) rm.prev_score = rm.score;
+    }
+
+    // Called at the start of each aspiration pass: orders the moves
+    // best-first by the last pass's scores (then the previous iteration's;
+    // ties keep order) and forgets those scores. A fail-high or timeout then
+    // leaves the moves this pass never reached at -999999, ranked among
+    // themselves by prev_score, instead of competing with stale values.
+    void begin_pass() {
+        std::stable_sort(moves.begin(), moves.end(), [](const RootMove& a, const RootMove& b) {
+            if (a.score != b.score) return a.score > b.score;
+            return a.prev_score > b.prev_score;
+        });
+        for (auto& rm : moves) rm.score = -999999;
+    }
+
+    void record(RootMove& rm, int ranked, uint64_t nodes_spent) {
+        rm.score = ranked;
+        rm.nodes += nodes_spent;
+        total_nodes += nodes_spent;
+    }
+
+    const RootMove* find(const MoveTriple& m) const {
+        for (const auto& rm : moves) if (same_move(rm.move, m)) return &rm;
+        return nullptr;
+    }
+
+    // Fraction of all root search effort spent below `m` (0..1).
+    double node_share(const MoveTriple& m) const {
+        const RootMove* rm = find(m);
+        if (!rm || total_nodes == 0) return 0.0;
+        return (double)rm->nodes / (double)total_nodes;
+    }
+};
 
-static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
+static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player, GameMode mode,
                                int max_depth, double time_limit_secs,
                                const std::atomic<bool>* stop_flag = nullptr,
                                ThreadData* td = nullptr) {
@@ -5293,7 +7812,7 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
     reset_time_state();
     g_nodes.store(0, std::memory_order_relaxed);
 
-    SearchState root = make_search_state(pieces, cpu_player, cpu_player);
+    SearchState root = make_search_state(pieces, cpu_player, cpu_player, mode);
     // Seed search path with game-level repetition history so the engine
     // avoids moves that create threefold repetition with prior positions.
     seed_search_hash_path_from_history(g_game_rep_history, root.hash);
@@ -5302,13 +7821,21 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
     if (all_moves.size() == 1) return {true, all_moves[0]};  // easy move
 
     MoveTriple book_move{};
-    if (g_use_opening_book && opening_book_pick(root, cpu_player, book_move)) {
+    if (book_pick(root, cpu_player, book_move)) {
         return {true, book_move};
     }
 
+    MoveTriple solved_move{};
+    if (pn_solve_root(root.pieces, cpu_player, root.mode, time_limit_secs, solved_move) != 0)
+        return {true, solved_move};
+    if (tb_pick_root_move(root.pieces, cpu_player, root.mode, solved_move))
+        return {true, solved_move};
+
     // Keep deterministic root order for stronger, reproducible play.
+    RootMoveTable root_table;
+    root_table.init(all_moves, root.pieces, cpu_player, td);
 
-    MoveTriple best = all_moves[0];
+    MoveTriple best = root_table.moves[0].move;
     int prev_score  = 0;
     int move_stability = 0;
     const bool opening_phase = (root.pieces.size() >= 34);
@@ -5317,6 +7844,7 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
 
     for (int cur_depth = 1; cur_depth <= max_depth; cur_depth++) {
         if (time_up()) break;
+        root_table.new_iteration();
 
         // ── Aspiration Windows ────────────────────────────────────────────
         // Start with a tight window (δ=12 at depth≥5, δ=40 earlier).
@@ -5336,28 +7864,16 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
             cur_best_rank = -999999;
             cur_best     = best;
 
-            MoveTriple root_hash_buf{};
-            const MoveTriple* root_hash_move = nullptr;
-            const TTDecoded* rt = tt_probe(root.hash);
-            if (rt) { root_hash_buf = tt_unpack_move(*rt); root_hash_move = &root_hash_buf; }
-
-            MoveTriple root_pv_buf{};
-            const MoveTriple* root_pv_move = nullptr;
-            int rpv_len = td ? td->pv_len[0] : g_pv_len[0];
-            if (rpv_len > 0) {
-                root_pv_buf = td ? td->pv[0][0] : g_pv[0][0];
-                root_pv_move = &root_pv_buf;
-            }
-
-            AllMoves root_moves = order_moves(all_moves, root.pieces, cpu_player, 0,
-                                              root_hash_move ? root_hash_move : &best,
-                                              root_pv_move, nullptr, td);
+            // Previous results order the root; no re-scoring per pass.
+            root_table.begin_pass();
 
             int window_alpha = alpha;
             int window_beta  = beta;
             int root_move_idx = 0;
-            for (auto& m : root_moves) {
+            for (auto& rm : root_table.moves) {
                 if (time_up()) break;
+                const MoveTriple m = rm.move;
+                const uint64_t nodes_before = g_thread_nodes;
                 int moved_idx = find_piece_idx_by_id(root.pieces, m.pid);
                 PieceKind moved_kind = (moved_idx >= 0) ? root.pieces[moved_idx].kind : PieceKind::None;
                 const Piece* root_target = piece_at_c(root.pieces, m.dc, m.dr);
@@ -5370,9 +7886,10 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
                 bool opp_immediate_win = false;
                 if (opening_phase) {
                     root_risk = opening_immediate_risk(root.pieces, cpu_player);
-                    opp_immediate_win = has_immediate_winning_move(root.pieces, opp(cpu_player));
+                    opp_immediate_win = has_immediate_winning_move(root.pieces, opp(cpu_player), root.mode);
                     if (root_risk >= 1000000) { // never allow immediate commander hangs
                         unmake_move_inplace(root, u);
+                        rm.score = -999999;
                         continue;
                     }
                 }
@@ -5406,6 +7923,8 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
                 }
                 int ranked = val - style_penalty;
 
+                root_table.record(rm, ranked, g_thread_nodes - nodes_before);
+
                 unmake_move_inplace(root, u);
                 if (val > cur_best_val) cur_best_val = val;
                 if (ranked > cur_best_rank) { cur_best_rank = ranked; cur_best = m; }
@@ -5437,8 +7956,11 @@ static AIResult cpu_pick_move(const PieceList& pieces, Player cpu_player,
             if (same_move(best, old_best)) move_stability++;
             else move_stability = 0;
             prev_score = cur_best_val;
-            // Soft-stop: stable best move past soft deadline
-            if (move_stability >= 3 && cur_depth >= 4 &&
+            // Soft-stop: stable best move past soft deadline. A best move that
+            // absorbs most of the root effort is trusted after less stability.
+            double best_share = root_table.node_share(best);
+            bool settled = move_stability >= 3 || (move_stability >= 1 && best_share >= 0.85);
+            if (settled && cur_depth >= 4 &&
                 std::chrono::steady_clock::now() > soft_deadline) {
                 break;
             }
@@ -5466,6 +7988,14 @@ static int smp_thread_count() {
 #endif
 }
 
+// A change of the move the search would return if stopped right then.
+struct SMPBestChange {
+    double     secs;
+    uint64_t   nodes;
+    int        depth;
+    MoveTriple move;
+};
+
 struct SMPShared {
     std::atomic<bool>   stop{false};
     std::atomic<int>    best_score{-999999};
@@ -5478,38 +8008,72 @@ struct SMPShared {
     std::atomic<int>    last_best_pid{-1};
     std::atomic<int>    last_best_dc{-1};
     std::atomic<int>    last_best_dr{-1};
+    std::atomic<int>    completed_depth{0};     // deepest iteration any thread completed
+    std::chrono::steady_clock::time_point start;
+    std::array<std::atomic<int64_t>, MAX_PLY + 1> depth_done_us{}; // first completion per depth; 0 = not yet
+    std::atomic<uint64_t> tt_probes{0};
+    std::atomic<uint64_t> tt_hits{0};
+    std::vector<SMPBestChange> best_changes; // guarded by best_mutex
 };
 
+// Per-thread search data persists across searches so history can decay
+// instead of being rebuilt from zero every move. Each search checks its
+// slots out of the pool and returns them when done, so concurrent searches
+// (the backend may run a bot move next to a hint) never share a ThreadData.
+static EngineMutex g_smp_td_mutex;
+static std::vector<std::unique_ptr<ThreadData>> g_smp_td_pool;
+
+static std::vector<std::unique_ptr<ThreadData>> smp_acquire_thread_data(int n) {
+    std::vector<std::unique_ptr<ThreadData>> out;
+    out.reserve((std::size_t)n);
+    {
+        std::lock_guard<EngineMutex> lk(g_smp_td_mutex);
+        while ((int)out.size() < n && !g_smp_td_pool.empty()) {
+            out.push_back(std::move(g_smp_td_pool.back()));
+            g_smp_td_pool.pop_back();
+        }
+    }
+    while ((int)out.size() < n) out.push_back(std::make_unique<ThreadData>());
+    return out;
+}
+
+static void smp_release_thread_data(std::vector<std::unique_ptr<ThreadData>>& tds) {
+    std::lock_guard<EngineMutex> lk(g_smp_td_mutex);
+    for (auto& td : tds) g_smp_td_pool.push_back(std::move(td));
+    tds.clear();
+}
+
 static void smp_worker(int thread_id, const PieceList& pieces,
-                        Player cpu_player,
-                        int max_depth, SMPShared& shared) {
+                        Player cpu_player, GameMode mode,
+                        int max_depth, SMPShared& shared, ThreadData& td) {
     init_lmr_table();
     reset_time_state();
-    // Each thread gets its own ThreadData
-    ThreadData td;
     td.thread_id = thread_id;
-    td.reset();
+    td.new_search();
 
     // Set up stop flag and deadline for this thread
     g_deadline = shared.deadline;
 
-    SearchState root = make_search_state(pieces, cpu_player, cpu_player);
+    SearchState root = make_search_state(pieces, cpu_player, cpu_player, mode);
     seed_search_hash_path_from_history(g_game_rep_history, root.hash);
     AllMoves all_moves = all_moves_for(root.pieces, cpu_player);
     if (all_moves.empty()) return;
 
+    RootMoveTable root_table;
+    root_table.init(all_moves, root.pieces, cpu_player, &td);
+
     // Diversify move ordering: thread 0 uses normal order, others shuffle early moves
-    if (thread_id > 0 && all_moves.size() > 2) {
+    if (thread_id > 0 && root_table.moves.size() > 2) {
         std::mt19937 rng(thread_id * 7919 + 42);
         // Shuffle only the first few moves to diversify while keeping structure
-        int shuffle_count = std::min((int)all_moves.size(), 4 + thread_id);
+        int shuffle_count = std::min((int)root_table.moves.size(), 4 + thread_id);
         for (int i = 0; i < shuffle_count - 1; i++) {
             std::uniform_int_distribution<int> dist(i, shuffle_count - 1);
-            std::swap(all_moves[i], all_moves[dist(rng)]);
+            std::swap(root_table.moves[i], root_table.moves[dist(rng)]);
         }
     }
 
-    MoveTriple best = all_moves[0];
+    MoveTriple best = root_table.moves[0].move;
     int prev_score = 0;
     const bool opening_phase = (root.pieces.size() >= 34);
     const bool very_early_opening = (root.pieces.size() >= 36);
@@ -5521,6 +8085,7 @@ static void smp_worker(int thread_id, const PieceList& pieces,
     for (int cur_depth = start_depth; cur_depth <= max_depth; cur_depth++) {
         if (shared.stop.load(std::memory_order_relaxed)) break;
         if (std::chrono::steady_clock::now() > shared.deadline) break;
+        root_table.new_iteration();
 
         // ── Aspiration Windows (Stockfish 18 tuning) ─────────────────────
         // δ=10 at depth≥6, δ=25 at depth 4-5, full window earlier.
@@ -5543,26 +8108,19 @@ static void smp_worker(int thread_id, const PieceList& pieces,
             cur_best_rank = -999999;
             cur_best = best;
 
-            MoveTriple root_hash_buf{};
-            const MoveTriple* root_hash_move = nullptr;
-            const TTDecoded* rt = tt_probe(root.hash);
-            if (rt) { root_hash_buf = tt_unpack_move(*rt); root_hash_move = &root_hash_buf; }
-
-            MoveTriple root_pv_buf{};
-            const MoveTriple* root_pv_move = nullptr;
-            if (td.pv_len[0] > 0) { root_pv_buf = td.pv[0][0]; root_pv_move = &root_pv_buf; }
-
-            AllMoves root_moves = order_moves(all_moves, root.pieces, cpu_player, 0,
-                                              root_hash_move ? root_hash_move : &best,
-                                              root_pv_move, nullptr, &td);
+            // Previous results order the root; no re-scoring per pass.
+            root_table.begin_pass();
 
             int window_alpha = alpha;
             int window_beta  = beta;
             int root_move_idx = 0;
 
-            for (auto& m : root_moves) {
+            for (auto& rm : root_table.moves) {
+                if (node_limit_reached()) shared.stop.store(true, std::memory_order_relaxed);
                 if (shared.stop.load(std::memory_order_relaxed)) break;
                 if (std::chrono::steady_clock::now() > shared.deadline) break;
+                const MoveTriple m = rm.move;
+                const uint64_t nodes_before = g_thread_nodes;
 
                 int moved_idx = find_piece_idx_by_id(root.pieces, m.pid);
                 PieceKind moved_kind = (moved_idx >= 0) ? root.pieces[moved_idx].kind : PieceKind::None;
@@ -5576,9 +8134,10 @@ static void smp_worker(int thread_id, const PieceList& pieces,
                 bool opp_immediate_win = false;
                 if (opening_phase) {
                     root_risk = opening_immediate_risk(root.pieces, cpu_player);
-                    opp_immediate_win = has_immediate_winning_move(root.pieces, opp(cpu_player));
+                    opp_immediate_win = has_immediate_winning_move(root.pieces, opp(cpu_player), root.mode);
                     if (root_risk >= 1000000) {
                         unmake_move_inplace(root, u);
+                        rm.score = -999999;
                         continue;
                     }
                 }
@@ -5610,6 +8169,8 @@ static void smp_worker(int thread_id, const PieceList& pieces,
                 }
                 int ranked = val - style_penalty;
 
+                root_table.record(rm, ranked, g_thread_nodes - nodes_before);
+
                 unmake_move_inplace(root, u);
                 if (val > cur_best_val) cur_best_val = val;
                 if (ranked > cur_best_rank) { cur_best_rank = ranked; cur_best = m; }
@@ -5618,6 +8179,7 @@ static void smp_worker(int thread_id, const PieceList& pieces,
                 if (val >= window_beta) break;
             }
 
+            if (node_limit_reached()) shared.stop.store(true, std::memory_order_relaxed);
             if (shared.stop.load(std::memory_order_relaxed)) break;
             if (std::chrono::steady_clock::now() > shared.deadline) break;
 
@@ -5640,6 +8202,16 @@ static void smp_worker(int thread_id, const PieceList& pieces,
 
         // Report to shared best if this thread found something good
         if (completed) {
+            if (cur_depth <= MAX_PLY) {
+                int64_t us = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - shared.start).count());
+                int64_t unset = 0;
+                shared.depth_done_us[(std::size_t)cur_depth].compare_exchange_strong(unset, us, std::memory_order_relaxed);
+            }
+            int deepest = shared.completed_depth.load(std::memory_order_relaxed);
+            while (cur_depth > deepest &&
+                   !shared.completed_depth.compare_exchange_weak(deepest, cur_depth, std::memory_order_relaxed)) {}
+
             int global_best = shared.best_score.load(std::memory_order_relaxed);
             if (cur_best_val > global_best || !shared.best_found) {
                 std::lock_guard<EngineMutex> lk(shared.best_mutex);
@@ -5648,6 +8220,10 @@ static void smp_worker(int thread_id, const PieceList& pieces,
                     shared.best_score.store(cur_best_val, std::memory_order_relaxed);
                     shared.best_move = best;
                     shared.best_found = true;
+                    if (shared.best_changes.empty() || !same_move(shared.best_changes.back().move, best)) {
+                        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - shared.start).count();
+                        shared.best_changes.push_back({secs, g_nodes.load(std::memory_order_relaxed), cur_depth, best});
+                    }
                 }
             }
 
@@ -5682,7 +8258,9 @@ static void smp_worker(int thread_id, const PieceList& pieces,
 
                 // ── Soft-stop: stable best move past soft deadline → stop ────
                 int stability = shared.best_move_stability.load(std::memory_order_relaxed);
-                if (stability >= 3 && cur_depth >= 4 &&
+                double best_share = root_table.node_share(best);
+                bool settled = stability >= 3 || (stability >= 1 && best_share >= 0.85);
+                if (settled && cur_depth >= 4 &&
                     std::chrono::steady_clock::now() > shared.soft_deadline) {
                     shared.stop.store(true, std::memory_order_relaxed);
                 }
@@ -5691,28 +8269,57 @@ static void smp_worker(int thread_id, const PieceList& pieces,
     }
 }
 
-static AIResult smp_cpu_pick_move(const PieceList& pieces, Player cpu_player,
-                                   int max_depth, double time_limit_secs,
-                                   const std::atomic<bool>* external_stop = nullptr) {
-    // Opening book check (single-threaded)
-    {
-        SearchState root = make_search_state(pieces, cpu_player, cpu_player);
-        AllMoves all_moves = all_moves_for(root.pieces, cpu_player);
-        if (all_moves.empty()) return {false, {}};
-        MoveTriple book_move{};
-        if (g_use_opening_book && opening_book_pick(root, cpu_player, book_move)) {
-            return {true, book_move};
-        }
-        // ── Easy move: only one legal move → use minimal time ────────────
-        if (all_moves.size() == 1) {
-            return {true, all_moves[0]};
-        }
+// Root positions that need no search: no moves, a book move, a single
+// legal move, or a solved endgame. Returns true with `out` set if so.
+static bool root_shortcut_move(const PieceList& pieces, Player cpu_player, GameMode mode,
+                               double time_limit_secs, AIResult& out) {
+    SearchState root = make_search_state(pieces, cpu_player, cpu_player, mode);
+    AllMoves all_moves = all_moves_for(root.pieces, cpu_player);
+    if (all_moves.empty()) { out = {false, {}}; return true; }
+    MoveTriple book_move{};
+    if (book_pick(root, cpu_player, book_move)) {
+        out = {true, book_move};
+        return true;
+    }
+    // ── Easy move: only one legal move → use minimal time ────────────────
+    if (all_moves.size() == 1) {
+        out = {true, all_moves[0]};
+        return true;
+    }
+    // ── Decided variant endgame: proof-number solver ─────────────────────
+    MoveTriple solved_move{};
+    if (pn_solve_root(root.pieces, cpu_player, root.mode, time_limit_secs, solved_move) != 0) {
+        out = {true, solved_move};
+        return true;
+    }
+    // ── Tablebase endgame: play the exact move ───────────────────────────
+    if (tb_pick_root_move(root.pieces, cpu_player, root.mode, solved_move)) {
+        out = {true, solved_move};
+        return true;
     }
+    return false;
+}
+
+// What the Lazy SMP search knew about the move it returned.
+struct SMPReport {
+    int score = 0; // root score of the returned move, CPU perspective
+    int depth = 0; // deepest iteration any thread completed
+    std::array<double, MAX_PLY + 1> depth_secs{}; // time to first complete each depth; 0 = not reached
+    uint64_t nodes = 0;
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    std::vector<SMPBestChange> best_changes; // returned move over time, oldest first
+};
 
+// Lazy SMP search proper, on `num_threads` workers (no root shortcuts).
+static AIResult smp_search(const PieceList& pieces, Player cpu_player, GameMode mode,
+                           int max_depth, double time_limit_secs,
+                           const std::atomic<bool>* external_stop,
+                           int num_threads, SMPReport* report = nullptr) {
+    if (report) *report = SMPReport{};
     g_tt_age++;
     g_nodes.store(0, std::memory_order_relaxed);
 
-    int num_threads = smp_thread_count();
     if (num_threads < 1) num_threads = 1;
     if (get_engine_config().force_single_thread) num_threads = 1; // WASM-SAFE
 
@@ -5723,19 +8330,27 @@ static AIResult smp_cpu_pick_move(const PieceList& pieces, Player cpu_player,
     auto search_start = std::chrono::steady_clock::now();
 
     SMPShared shared;
+    shared.start = search_start;
     shared.deadline = search_start +
                       std::chrono::milliseconds((int)(hard_limit * 1000));
     shared.soft_deadline = search_start +
                            std::chrono::milliseconds((int)(soft_limit * 1000));
     g_deadline = shared.deadline;
 
+    std::vector<std::unique_ptr<ThreadData>> tds = smp_acquire_thread_data(num_threads);
+
     const std::vector<uint64_t> game_rep_history_copy = g_game_rep_history;
     auto run_worker = [&](int thread_id) {
         g_stop_flag = external_stop;
         g_deadline = shared.deadline;
         g_game_rep_history = game_rep_history_copy;
         reset_time_state();
-        smp_worker(thread_id, pieces, cpu_player, max_depth, shared);
+        ThreadData& td = *tds[(std::size_t)thread_id];
+        const uint64_t probes_before = td.tt_probes;
+        const uint64_t hits_before = td.tt_hits;
+        smp_worker(thread_id, pieces, cpu_player, mode, max_depth, shared, td);
+        shared.tt_probes.fetch_add(td.tt_probes - probes_before, std::memory_order_relaxed);
+        shared.tt_hits.fetch_add(td.tt_hits - hits_before, std::memory_order_relaxed);
     };
 
     if (num_threads <= 1) {
@@ -5754,12 +8369,115 @@ static AIResult smp_cpu_pick_move(const PieceList& pieces, Player cpu_player,
         run_worker(0);
 #endif
     }
+    smp_release_thread_data(tds);
 
+    if (report) {
+        report->score = shared.best_score.load(std::memory_order_relaxed);
+        report->depth = shared.completed_depth.load(std::memory_order_relaxed);
+        for (std::size_t d = 0; d < report->depth_secs.size(); d++)
+            report->depth_secs[d] = (double)shared.depth_done_us[d].load(std::memory_order_relaxed) / 1e6;
+        report->nodes = g_nodes.load(std::memory_order_relaxed);
+        report->tt_probes = shared.tt_probes.load(std::memory_order_relaxed);
+        report->tt_hits = shared.tt_hits.load(std::memory_order_relaxed);
+        report->best_changes = std::move(shared.best_changes);
+    }
     if (shared.best_found)
         return {true, shared.best_move};
 
     return {false, {}};
 }
+
+static AIResult smp_cpu_pick_move(const PieceList& pieces, Player cpu_player, GameMode mode,
+                                   int max_depth, double time_limit_secs,
+                                   const std::atomic<bool>* external_stop = nullptr) {
+    AIResult shortcut;
+    if (root_shortcut_move(pieces, cpu_player, mode, time_limit_secs, shortcut)) return shortcut;
+    return smp_search(pieces, cpu_player, mode, max_depth, time_limit_secs, external_stop,
+                      smp_thread_count());
+}
+
+// ── Portfolio search (MCTS ∥ Lazy SMP) ───────────────────────────────────
+// The MCTS group and the Lazy SMP group search the same root at the same
+// time over the shared TT, splitting the worker threads between them. SMP
+// keeps its soft-stop time management: when it finishes, MCTS is stopped
+// too. A proof from either side ends both. Without a second hardware
+// thread the two run back to back (70% / 28% of the budget).
+
+// Picks between the two answers. Proofs decide outright. Otherwise an
+// agreed move is kept, and on disagreement MCTS is trusted only if its
+// horizon (tree depth plus AB value-head depth) beat SMP's completed depth
+// and it put at least half of the root visits on its move.
+static AIResult portfolio_referee(const AIResult& mcts, const MCTSReport& mr,
+                                  const AIResult& smp, const SMPReport& sr, int ab_depth) {
+    if (!mcts.found) return smp;
+    if (!smp.found) return mcts;
+    if (mr.proof == MCTS_PROVEN_WIN) return mcts;
+    if (sr.score >= MCTS_DECISIVE_SCORE) return smp;
+    if (same_move(mcts.move, smp.move)) return smp;
+    if (mr.proof == MCTS_PROVEN_LOSS) return smp;
+    if (sr.score <= -MCTS_DECISIVE_SCORE) return mcts;
+    bool mcts_deeper = mr.max_depth + ab_depth > sr.depth;
+    bool mcts_confident = mr.root_visits > 0 && 2 * mr.visits >= mr.root_visits;
+    return (mcts_deeper && mcts_confident) ? mcts : smp;
+}
+
+// Hard-mode entry point shared by the GUI, --sim and the backend.
+static AIResult portfolio_pick_move(const PieceList& pieces, Player cpu_player, GameMode mode,
+                                    int max_depth, double time_limit_secs,
+                                    const std::atomic<bool>* external_stop = nullptr) {
+    AIResult shortcut;
+    if (root_shortcut_move(pieces, cpu_player, mode, time_limit_secs, shortcut)) return shortcut;
+
+    const int ab_depth = engine_mcts_ab_depth();
+    const int total_threads = smp_thread_count();
+    AIResult mcts{false, {}}, smp{false, {}};
+    MCTSReport mr;
+    SMPReport sr;
+
+    if (total_threads < 2) {
+        mcts = mcts_ab_root_search(pieces, cpu_player, mode, ab_depth, time_limit_secs * 0.70,
+                                   external_stop, 0, &mr);
+        if (external_stop && external_stop->load(std::memory_order_relaxed)) return mcts;
+        if (mr.proof != MCTS_PROVEN_WIN)
+            smp = smp_search(pieces, cpu_player, mode, max_depth, time_limit_secs * 0.28,
+                             external_stop, 1, &sr);
+        return portfolio_referee(mcts, mr, smp, sr, ab_depth);
+    }
+
+#if COMMANDER_ENABLE_THREADS
+    const int mcts_workers = std::max(1, total_threads / 2);
+    const int smp_threads = std::max(1, total_threads - mcts_workers);
+    const std::vector<uint64_t> game_rep_history_copy = g_game_rep_history;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> mcts_done{false}, smp_done{false};
+
+    std::thread mcts_thread([&]() {
+        g_game_rep_history = game_rep_history_copy;
+        mcts = mcts_ab_root_search(pieces, cpu_player, mode, ab_depth, time_limit_secs,
+                                   &stop, mcts_workers, &mr);
+        mcts_done.store(true, std::memory_order_release);
+    });
+    std::thread smp_thread([&]() {
+        g_game_rep_history = game_rep_history_copy;
+        smp = smp_search(pieces, cpu_player, mode, max_depth, time_limit_secs,
+                         &stop, smp_threads, &sr);
+        smp_done.store(true, std::memory_order_release);
+    });
+
+    while (!(mcts_done.load(std::memory_order_acquire) && smp_done.load(std::memory_order_acquire))) {
+        bool halt = (external_stop && external_stop->load(std::memory_order_relaxed)) ||
+                    smp_done.load(std::memory_order_acquire) ||
+                    (mcts_done.load(std::memory_order_acquire) && mr.proof != MCTS_UNPROVEN);
+        if (halt) stop.store(true, std::memory_order_relaxed);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    mcts_thread.join();
+    smp_thread.join();
+    return portfolio_referee(mcts, mr, smp, sr, ab_depth);
+#else
+    return smp_search(pieces, cpu_player, mode, max_depth, time_limit_secs, external_stop, 1);
+#endif
+}
 // COORDINATE HELPERS
 // ═══════════════════════════════════════════════════════════════════════════
 
@@ -5840,6 +8558,7 @@ struct Game {
     std::string status_msg;
     int difficulty = 1; // 0=Easy, 1=Medium, 2=Hard
     GameMode selected_mode = GameMode::FULL_BATTLE;
+    GameMode game_mode = GameMode::FULL_BATTLE; // mode of the game in progress
     bool show_mode_menu = true;
     Player human_player = Player::Red;
     Player cpu_player = Player::Blue;
@@ -5874,7 +8593,7 @@ struct Game {
         position_history.clear();
         push_position_history(position_history, zobrist_hash(pieces, current));
         set_difficulty(difficulty);
-        g_game_mode = selected_mode;
+        game_mode = selected_mode;
         status_msg = "Select mode, choose side, then click START GAME";
     }
     ~Game() { stop_cpu(); }
@@ -6058,7 +8777,7 @@ struct Game {
 
     void new_game() {
         stop_cpu();
-        g_game_mode = selected_mode;
+        game_mode = selected_mode;
         pieces = make_initial_pieces();
         current = Player::Red; // Red always starts; CPU may move first if user picked Blue.
         selected_id = -1;
@@ -6206,7 +8925,7 @@ struct Game {
         move_log.push_back(log);
         move_records.push_back(rec);
 
-        std::string wm = check_win(pieces, current);
+        std::string wm = check_win(pieces, current, game_mode);
         if (!wm.empty()) {
             state_history.push_back(pieces);
             turn_history.push_back(opp(current));
@@ -6249,47 +8968,20 @@ struct Game {
         }
         PieceList pieces_copy = pieces;
         Player cpu_pl = cpu_player;
+        GameMode mode = game_mode;
         int depth = cpu_depth;
         double tlimit = cpu_time_limit;
 
-        auto run_cpu_search = [this, pieces_copy, cpu_pl, depth, tlimit]() {
+        auto run_cpu_search = [this, pieces_copy, cpu_pl, mode, depth, tlimit]() {
             try {
                 reset_search_tables();
                 g_game_rep_history = position_history;  // let search see game repetition history
                 AIResult res;
                 if (g_use_mcts) {
-                    // Hard difficulty: MCTS-guided root with AB value function
-                    // Opening book is checked inside smp_cpu_pick_move, but we
-                    // also check it here so MCTS skips it.
-                    {
-                        SearchState root_st = make_search_state(pieces_copy, cpu_pl, cpu_pl);
-                        MoveTriple book_mv{};
-                        if (g_use_opening_book && opening_book_pick(root_st, cpu_pl, book_mv)) {
-                            if (!cpu_stop.load(std::memory_order_relaxed)) {
-                                std::lock_guard<EngineMutex> lk(cpu_mutex);
-                                cpu_result = {true, book_mv};
-                                cpu_done   = true;
-                            }
-                            return;
-                        }
-                    }
-                    // Run MCTS+AB for the bulk of the time, then verify the
-                    // top candidate with a final deeper SMP pass on the last 30%.
-                    double mcts_time = tlimit * 0.70;
-                    double verify_time = tlimit * 0.28;
-                    res = mcts_ab_root_search(pieces_copy, cpu_pl,
-                                              engine_mcts_ab_depth(), mcts_time, &cpu_stop);
-                    // If MCTS found a move, run quick SMP verification
-                    if (res.found && !cpu_stop.load(std::memory_order_relaxed)) {
-                        // Hint: put MCTS best move into TT so SMP searches it first
-                        // (it's already there from MCTS AB calls, so just re-search)
-                        AIResult verify = smp_cpu_pick_move(pieces_copy, cpu_pl,
-                                                            depth, verify_time, &cpu_stop);
-                        // Prefer the deeper AB result if it finds a move
-                        if (verify.found) res = verify;
-                    }
+                    // Hard difficulty: MCTS and Lazy SMP side by side.
+                    res = portfolio_pick_move(pieces_copy, cpu_pl, mode, depth, tlimit, &cpu_stop);
                 } else {
-                    res = smp_cpu_pick_move(pieces_copy, cpu_pl, depth, tlimit, &cpu_stop);
+                    res = smp_cpu_pick_move(pieces_copy, cpu_pl, mode, depth, tlimit, &cpu_stop);
                 }
                 if (cpu_stop.load(std::memory_order_relaxed)) return;
                 std::lock_guard<EngineMutex> lk(cpu_mutex);
@@ -7399,6 +10091,7 @@ struct SimOptions {
     int max_plies = 300;
     std::string start = "alternate"; // red | blue | alternate | random
     bool mcts = false;
+    std::string position; // --position: start every game here instead of the initial setup
 };
 
 static bool parse_i32_arg(const char* s, int& out) {
@@ -7418,20 +10111,62 @@ static void print_usage(const char* prog) {
         << "  " << prog << "\n"
         << "  " << prog << " [--eval_backend MODE]\n"
         << "  " << prog << " --sim [--games N] [--seed S] [--depth D] [--time_ms T] [--max_plies P] [--start MODE] [--mcts]\n"
+        << "  " << prog << " --tb-gen DIR [--tb-units N] [--tb-max-mb M]\n"
+        << "  " << prog << " --book-gen FILE [--book-games N] [--book-plies P] [--book-depth D] [--book-time-ms T] [--book-mode MODE]\n"
+        << "  " << prog << " --bench [depth] [threads] [hash]\n"
+        << "  " << prog << " --bench-smp [depth] [max_threads] [hash]\n"
+        << "  " << prog << " --suite FILE [--suite-time-ms T] [--suite-nodes N] [--suite-threads N] [--suite-workers W] [--suite-hash MB]\n"
         << "\n"
         << "General options:\n"
         << "  --eval_backend MODE    MODE: auto | cpu | webgpu   (default: auto)\n"
+        << "  --tb-dir DIR           endgame tablebase directory (default: tablebases)\n"
+        << "  --book FILE            binary opening book (default: opening_book.ccbk)\n"
+        << "  --position TEXT        start --sim/--book-gen games here, or --bench only this position\n"
+        << "\n"
+        << "Position notation (TEXT, one shell argument):\n"
+        << "  <board> <r|b> [full|marine|air|land], ranks 11..0 split by '/', digits = empty squares\n"
+        << "  C H I M T E A D(AntiAircraft) R(Missile) F(AirForce) N; Red upper, Blue lower case,\n"
+        << "  '+' = hero, carried pieces in parentheses after the carrier: N(FT)\n"
+        << "\n"
+        << "Tablebase generation (--tb-gen):\n"
+        << "  --tb-units 1 --tb-max-mb 64   units besides Commanders/HQs; largest table index\n"
+        << "\n"
+        << "Benchmark (--bench):\n"
+        << "  fixed-depth search of a built-in position suite (default: depth 5, 1 thread, 64 MB hash);\n"
+        << "  with one thread the total node count is a deterministic search signature\n"
+        << "  --bench-smp repeats the suite at 1, 2, 4, ... max_threads (default: all hardware threads)\n"
+        << "  and prints CSV: nodes/sec speedup, time to each depth, TT duplicate ratio, best-move changes\n"
+        << "\n"
+        << "Test suite (--suite):\n"
+        << "  one position per line: <position> bm <move>...; am <move>...; id \"name\";\n"
+        << "  moves as <piece><col>,<row>-<col>,<row>, e.g. T5,3-5,5; reports solved count,\n"
+        << "  time and nodes to solution\n"
+        << "  --suite-time-ms 1000 --suite-nodes 0 (no limit) --suite-threads 1 --suite-workers 1 --suite-hash 64\n"
+        << "  workers solve positions in parallel as separate processes (POSIX only)\n"
+        << "\n"
+        << "Opening book generation (--book-gen):\n"
+        << "  --book-games 200 --book-plies 12 --book-depth 10 --book-time-ms 2000 --book-mode full\n"
+        << "  MODE: full | marine | air | land\n"
         << "\n"
         << "Defaults in --sim mode:\n"
         << "  --games 1000 --seed 1 --depth 4 --time_ms 50 --max_plies 300 --start alternate\n"
         << "  MODE: red | blue | alternate | random\n"
-        << "  --mcts enables hybrid MCTS+AB move selection in sim mode\n";
+        << "  --mcts enables the MCTS + Lazy SMP portfolio search in sim mode\n";
 }
 
 static int run_headless_sim(const SimOptions& opt) {
     init_zobrist();
     tt_ensure_allocated();
     std::srand((unsigned int)opt.seed);
+    GameMode mode = GameMode::FULL_BATTLE;
+    PieceList start_pieces = make_initial_pieces();
+    Player start_turn = Player::Red;
+    std::string position_why;
+    if (!opt.position.empty() &&
+        !parse_start_position(opt.position, start_pieces, start_turn, mode, &position_why)) {
+        std::cerr << "[sim] invalid --position: " << position_why << "\n";
+        return 1;
+    }
     std::mt19937 rng((uint32_t)opt.seed);
     bool prev_book = g_use_opening_book;
     bool prev_mcts = g_use_mcts;
@@ -7450,11 +10185,13 @@ static int run_headless_sim(const SimOptions& opt) {
     auto t0 = std::chrono::steady_clock::now();
 
     for (int g = 0; g < opt.games; g++) {
-        PieceList pieces = make_initial_pieces();
-        Player turn = Player::Red;
-        if (opt.start == "blue") turn = Player::Blue;
-        else if (opt.start == "alternate") turn = (g % 2 == 0) ? Player::Red : Player::Blue;
-        else if (opt.start == "random") turn = (std::uniform_int_distribution<int>(0, 1)(rng) == 0) ? Player::Red : Player::Blue;
+        PieceList pieces = start_pieces;
+        Player turn = start_turn;
+        if (opt.position.empty()) { // a --position fixes the side to move
+            if (opt.start == "blue") turn = Player::Blue;
+            else if (opt.start == "alternate") turn = (g % 2 == 0) ? Player::Red : Player::Blue;
+            else if (opt.start == "random") turn = (std::uniform_int_distribution<int>(0, 1)(rng) == 0) ? Player::Red : Player::Blue;
+        }
         Player starter = turn;
         if (starter == Player::Red) started_red++;
         else started_blue++;
@@ -7462,13 +10199,14 @@ static int run_headless_sim(const SimOptions& opt) {
         push_position_history(rep_history, zobrist_hash(pieces, turn));
 
         std::string init_why;
-        if (!validate_state_for_sim(pieces, opp(starter), &init_why)) {
+        if (!validate_state_for_sim(pieces, opp(starter), mode, &init_why)) {
             std::cerr
                 << "[sim] invalid initial state"
                 << " seed=" << opt.seed
                 << " game=" << g
                 << " starter=" << player_to_string(starter)
-                << " reason=\"" << init_why << "\"\n";
+                << " reason=\"" << init_why << "\""
+                << " position=\"" << position_to_text(pieces, starter, mode) << "\"\n";
             std::abort();
         }
         bool finished = false;
@@ -7480,7 +10218,8 @@ static int run_headless_sim(const SimOptions& opt) {
             reset_search_tables();
             tt_clear();  // Self-play: purge TT every move since perspective alternates
             g_game_rep_history = rep_history;  // let search see game's repetition history
-            AIResult r = cpu_pick_move(pieces, turn, opt.depth, time_limit_secs);
+            AIResult r = g_use_mcts ? portfolio_pick_move(pieces, turn, mode, opt.depth, time_limit_secs)
+                                    : cpu_pick_move(pieces, turn, mode, opt.depth, time_limit_secs);
             if (!r.found) {
                 draws++;
                 finished = true;
@@ -7490,7 +10229,7 @@ static int run_headless_sim(const SimOptions& opt) {
             pieces = apply_move(pieces, r.move.pid, r.move.dc, r.move.dr, turn);
 
             std::string why;
-            if (!validate_state_for_sim(pieces, turn, &why)) {
+            if (!validate_state_for_sim(pieces, turn, mode, &why)) {
                 std::cerr
                     << "[sim] invalid state"
                     << " seed=" << opt.seed
@@ -7498,11 +10237,12 @@ static int run_headless_sim(const SimOptions& opt) {
                     << " ply=" << ply
                     << " turn=" << player_to_string(turn)
                     << " move=(" << r.move.pid << " -> " << r.move.dc << "," << r.move.dr << ")"
-                    << " reason=\"" << why << "\"\n";
+                    << " reason=\"" << why << "\""
+                    << " position=\"" << position_to_text(pieces, opp(turn), mode) << "\"\n";
                 std::abort();
             }
 
-            std::string win = check_win(pieces, turn);
+            std::string win = check_win(pieces, turn, mode);
             if (!win.empty()) {
                 if (turn == Player::Red) red_wins++;
                 else               blue_wins++;
@@ -7536,8 +10276,9 @@ static int run_headless_sim(const SimOptions& opt) {
               << " depth=" << opt.depth
               << " time_ms=" << opt.time_ms
               << " max_plies=" << opt.max_plies
-              << " start=" << opt.start
+              << " start=" << (opt.position.empty() ? opt.start : "position")
               << " mcts=" << (opt.mcts ? 1 : 0) << "\n";
+    if (!opt.position.empty()) std::cout << "POSITION: " << opt.position << "\n";
     std::cout << "EVAL BACKEND: " << eval_backend_name(active_eval_backend()) << "\n";
     std::cout << "RESULTS: red_wins=" << red_wins
               << " blue_wins=" << blue_wins
@@ -7558,11 +10299,678 @@ static int run_headless_sim(const SimOptions& opt) {
 // MAIN
 // ═══════════════════════════════════════════════════════════════════════════
 
+// ── Opening book builder (--book-gen) ─────────────────────────────────────
+struct BookGenOptions {
+    std::string path;
+    int games = 200;
+    int plies = 12;        // book depth from the initial position
+    int random_plies = 6;  // plies where play may deviate to other top-ordered moves
+    int depth = 10;
+    int time_ms = 2000;
+    GameMode mode = GameMode::FULL_BATTLE;
+    std::string position; // --position: book the lines from here instead of the initial setup
+};
+
+// Self-play with deep SMP searches. Every visited position records the move
+// the search chose; early plies sometimes follow another well-ordered move so
+// the book covers sidelines. Weights count how often the search chose a move.
+static int run_book_builder(const BookGenOptions& opt) {
+    init_zobrist();
+    tt_ensure_allocated();
+    GameMode mode = opt.mode;
+    PieceList start_pieces = make_initial_pieces();
+    Player start_turn = Player::Red;
+    std::string position_why;
+    if (!opt.position.empty() &&
+        !parse_start_position(opt.position, start_pieces, start_turn, mode, &position_why)) {
+        std::cerr << "[book] invalid --position: " << position_why << "\n";
+        return 1;
+    }
+    bool prev_book = g_use_opening_book;
+    g_use_opening_book = false;
+    std::mt19937 rng(1);
+    std::map<std::pair<uint64_t, uint32_t>, uint32_t> chosen; // (key, from|kind|to) -> count
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int g = 0; g < opt.games; g++) {
+        PieceList pieces = start_pieces;
+        Player turn = start_turn;
+        if (opt.position.empty()) turn = (g % 2 == 0) ? Player::Red : Player::Blue;
+        std::vector<uint64_t> rep_history;
+        push_position_history(rep_history, zobrist_hash(pieces, turn));
+        for (int ply = 0; ply < opt.plies; ply++) {
+            reset_search_tables();
+            tt_clear();
+            g_game_rep_history = rep_history;
+            AIResult r = smp_cpu_pick_move(pieces, turn, mode, opt.depth, opt.time_ms / 1000.0);
+            if (!r.found) break;
+            const Piece* mover = piece_by_id_c(pieces, r.move.pid);
+            if (!mover) break;
+            uint32_t packed = ((uint32_t)sq_index(mover->col, mover->row) << 16) |
+                              ((uint32_t)mover->kind << 8) | (uint32_t)sq_index(r.move.dc, r.move.dr);
+            chosen[{book_key(pieces, turn, mode), packed}]++;
+
+            MoveTriple play = r.move;
+            if (ply < opt.random_plies && (rng() & 1)) {
+                AllMoves ordered = order_moves(all_moves_for(pieces, turn), pieces, turn, 0, nullptr);
+                int k = std::min<int>(4, (int)ordered.size());
+                if (k > 0) {
+                    MoveTriple alt = ordered[(std::size_t)(rng() % (uint32_t)k)];
+                    PieceList np = apply_move(pieces, alt.pid, alt.dc, alt.dr, turn);
+                    if (!has_immediate_winning_move(np, opp(turn), mode)) play = alt;
+                }
+            }
+            pieces = apply_move(pieces, play.pid, play.dc, play.dr, turn);
+            push_position_history(rep_history, zobrist_hash(pieces, opp(turn)));
+            if (!check_win(pieces, turn, mode).empty()) break;
+            turn = opp(turn);
+        }
+        std::cerr << "[book] game " << (g + 1) << "/" << opt.games << ", " << chosen.size() << " moves\n";
+    }
+    g_use_opening_book = prev_book;
+
+    std::vector<BookEntry> entries;
+    entries.reserve(chosen.size());
+    for (const auto& kv : chosen) {
+        BookEntry e{};
+        e.key = kv.first.first;
+        e.from_sq = (uint8_t)(kv.first.second >> 16);
+        e.kind = (uint8_t)(kv.first.second >> 8);
+        e.to_sq = (uint8_t)kv.first.second;
+        e.weight = (uint16_t)std::min<uint32_t>(kv.second, 65535);
+        entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+    BookFileHeader hdr{};
+    std::memcpy(hdr.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    hdr.entries = entries.size();
+    std::ofstream out(opt.path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    out.write(reinterpret_cast<const char*>(entries.data()), (std::streamsize)(entries.size() * sizeof(BookEntry)));
+    if (!out) {
+        std::cerr << "[book] cannot write " << opt.path << "\n";
+        return 1;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "BOOK: " << entries.size() << " moves, " << game_mode_name(mode) << ", "
+              << opt.games << " games x " << opt.plies << " plies, depth " << opt.depth
+              << ", " << std::fixed << std::setprecision(1) << secs << "s -> " << opt.path << "\n";
+    return 0;
+}
+
+// ── Benchmark (--bench) ───────────────────────────────────────────────────
+// Fixed-depth Lazy SMP searches over a built-in position suite. With one
+// thread the total node count is a deterministic signature of the search:
+// it changes only when move generation, ordering, pruning or evaluation
+// does. Tablebases are switched off so the result does not depend on files.
+struct BenchOptions {
+    bool enabled = false;
+    bool smp_scaling = false; // --bench-smp: `threads` is the largest count, 0 = all hardware threads
+    int depth = 5;
+    int threads = 1;
+    int hash_mb = 64;
+    std::string position; // --position: search only this position instead of the suite
+};
+
+struct BenchUnit {
+    Player    player;
+    PieceKind kind;
+    int8_t    col, row;
+    int8_t    carried_by; // index of the carrier within the position, -1 = none
+    bool      hero = false;
+};
+
+struct BenchPosition {
+    const char* name;
+    GameMode mode;
+    Player to_move;
+    std::vector<BenchUnit> units; // empty = initial setup
+};
+
+static std::vector<BenchPosition> bench_positions() {
+    using K = PieceKind;
+    const Player R = Player::Red, B = Player::Blue;
+    return {
+        {"opening full", GameMode::FULL_BATTLE, R, {}},
+        {"opening marine", GameMode::MARINE_BATTLE, B, {}},
+        {"opening air", GameMode::AIR_BATTLE, R, {}},
+        {"opening land", GameMode::LAND_BATTLE, B, {}},
+        {"middlegame carriers", GameMode::FULL_BATTLE, R, {
+            {R, K::Commander, 6, 0, -1}, {R, K::HQ, 5, 1, -1}, {R, K::HQ, 7, 1, -1},
+            {R, K::Navy, 1, 3, -1}, {R, K::AirForce, 1, 3, 3}, {R, K::Tank, 1, 3, 3},
+            {R, K::Navy, 2, 5, -1}, {R, K::Infantry, 2, 5, 6},
+            {R, K::AirForce, 4, 4, -1}, {R, K::Infantry, 4, 4, 8},
+            {R, K::Tank, 5, 4, -1}, {R, K::Militia, 5, 4, 10},
+            {R, K::Engineer, 8, 4, -1}, {R, K::Artillery, 8, 4, 12},
+            {R, K::AntiAircraft, 4, 2, -1}, {R, K::Missile, 6, 2, -1},
+            {R, K::Infantry, 7, 4, -1}, {R, K::Artillery, 3, 3, -1},
+            {B, K::Commander, 6, 11, -1}, {B, K::HQ, 5, 10, -1}, {B, K::HQ, 7, 10, -1},
+            {B, K::Navy, 1, 8, -1}, {B, K::Tank, 1, 8, 21}, {B, K::Tank, 1, 8, 21},
+            {B, K::Navy, 2, 9, -1},
+            {B, K::AirForce, 8, 8, -1}, {B, K::Engineer, 8, 8, 25},
+            {B, K::Tank, 5, 7, -1}, {B, K::Infantry, 5, 7, 27},
+            {B, K::AntiAircraft, 8, 9, -1}, {B, K::Missile, 6, 9, -1},
+            {B, K::Artillery, 3, 8, -1}, {B, K::Infantry, 7, 7, -1},
+        }},
+        {"middlegame open", GameMode::FULL_BATTLE, B, {
+            {R, K::Commander, 6, 1, -1}, {R, K::HQ, 5, 1, -1},
+            {R, K::Navy, 0, 4, -1}, {R, K::AirForce, 0, 4, 2},
+            {R, K::Tank, 4, 4, -1}, {R, K::Engineer, 4, 4, 4},
+            {R, K::Artillery, 8, 3, -1}, {R, K::Missile, 6, 3, -1},
+            {R, K::Infantry, 3, 4, -1}, {R, K::AirForce, 9, 2, -1},
+            {B, K::Commander, 6, 10, -1}, {B, K::HQ, 7, 10, -1},
+            {B, K::Navy, 2, 7, -1}, {B, K::Infantry, 2, 7, 12},
+            {B, K::Tank, 7, 7, -1}, {B, K::AntiAircraft, 5, 8, -1},
+            {B, K::Artillery, 3, 9, -1},
+            {B, K::AirForce, 8, 10, -1}, {B, K::Tank, 8, 10, 17},
+            {B, K::Militia, 6, 8, -1},
+        }},
+        {"endgame full", GameMode::FULL_BATTLE, R, {
+            {R, K::Commander, 5, 2, -1}, {R, K::Tank, 6, 4, -1},
+            {R, K::Artillery, 3, 3, -1}, {R, K::Infantry, 8, 4, -1},
+            {B, K::Commander, 6, 9, -1}, {B, K::Infantry, 4, 7, -1},
+            {B, K::AirForce, 8, 9, -1}, {B, K::Militia, 7, 8, -1},
+        }},
+        {"endgame marine", GameMode::MARINE_BATTLE, R, {
+            {R, K::Commander, 6, 0, -1}, {R, K::Navy, 1, 2, -1}, {R, K::Navy, 0, 5, -1},
+            {R, K::AirForce, 4, 3, -1}, {R, K::Missile, 6, 2, -1},
+            {B, K::Commander, 6, 11, -1}, {B, K::Navy, 1, 9, -1}, {B, K::AirForce, 1, 9, 6},
+            {B, K::AntiAircraft, 3, 8, -1}, {B, K::Artillery, 4, 9, -1},
+        }},
+        {"endgame air", GameMode::AIR_BATTLE, B, {
+            {R, K::Commander, 6, 0, -1}, {R, K::AirForce, 4, 2, -1},
+            {R, K::AirForce, 8, 3, -1}, {R, K::Infantry, 8, 3, 2},
+            {R, K::AntiAircraft, 6, 3, -1}, {R, K::Tank, 5, 4, -1},
+            {B, K::Commander, 6, 11, -1}, {B, K::AirForce, 7, 9, -1},
+            {B, K::AntiAircraft, 4, 8, -1}, {B, K::Missile, 6, 9, -1}, {B, K::Infantry, 8, 7, -1},
+        }},
+        {"endgame land", GameMode::LAND_BATTLE, R, {
+            {R, K::Commander, 6, 0, -1}, {R, K::Tank, 5, 3, -1}, {R, K::Infantry, 7, 4, -1},
+            {R, K::Artillery, 3, 2, -1}, {R, K::Engineer, 8, 4, -1},
+            {B, K::Commander, 6, 11, -1}, {B, K::Tank, 6, 8, -1}, {B, K::Militia, 6, 8, 6},
+            {B, K::Infantry, 4, 7, -1}, {B, K::Artillery, 8, 9, -1}, {B, K::Infantry, 9, 8, -1},
+        }},
+    };
+}
+
+static PieceList bench_pieces(const BenchPosition& pos) {
+    if (pos.units.empty()) return make_initial_pieces();
+    PieceList pieces;
+    for (std::size_t i = 0; i < pos.units.size(); i++) {
+        const BenchUnit& u = pos.units[i];
+        pieces.push_back({(int16_t)i, u.player, u.kind, u.col, u.row, u.hero, u.carried_by});
+    }
+    return pieces;
+}
+
+// The built-in suite, or just the --position one. Parsed ids are indices,
+// so carriers map straight onto BenchUnit::carried_by.
+static std::vector<BenchPosition> bench_suite(const BenchOptions& opt) {
+    if (opt.position.empty()) return bench_positions();
+    PieceList pieces;
+    BenchPosition pos{"position", GameMode::FULL_BATTLE, Player::Red, {}};
+    if (!position_from_text(opt.position, pieces, pos.to_move, pos.mode)) return {};
+    for (const Piece& p : pieces) pos.units.push_back({p.player, p.kind, p.col, p.row, p.carrier_id, p.hero});
+    return {pos};
+}
+
+static int run_bench(const BenchOptions& opt) {
+    init_zobrist();
+    tt_resize((size_t)opt.hash_mb);
+    const EngineConfig saved_cfg = get_engine_config();
+    EngineConfig cfg = saved_cfg;
+    cfg.tablebase_dir.clear();
+    set_engine_config(cfg);
+    tb_forget_tables();
+
+    const std::vector<BenchPosition> suite = bench_suite(opt);
+    uint64_t total_nodes = 0;
+    double total_secs = 0.0;
+    int status = 0;
+    for (std::size_t i = 0; i < suite.size(); i++) {
+        const BenchPosition& pos = suite[i];
+        PieceList pieces = bench_pieces(pos);
+        if (!validate_state(pieces)) {
+            std::cerr << "[bench] invalid position: " << pos.name << "\n";
+            status = 1;
+            break;
+        }
+        tt_clear();
+        reset_search_tables();
+        g_game_rep_history.clear();
+        auto t0 = std::chrono::steady_clock::now();
+        AIResult r = smp_search(pieces, pos.to_move, pos.mode, opt.depth, 86400.0, nullptr, opt.threads);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        uint64_t nodes = g_nodes.load(std::memory_order_relaxed);
+        total_nodes += nodes;
+        total_secs += secs;
+        std::cout << "Position " << (i + 1) << "/" << suite.size() << " (" << pos.name << "): "
+                  << nodes << " nodes, best " << r.move.pid << "->" << r.move.dc << "," << r.move.dr << "\n";
+    }
+
+    set_engine_config(saved_cfg);
+    if (status != 0) return status;
+    std::cout << "===========================\n"
+              << "Total time (ms) : " << (uint64_t)(total_secs * 1000.0) << "\n"
+              << "Nodes searched  : " << total_nodes << "\n"
+              << "Nodes/second    : " << (uint64_t)(total_secs > 0.0 ? total_nodes / total_secs : 0.0) << "\n";
+    return 0;
+}
+
+// ── SMP scaling report (--bench-smp) ──────────────────────────────────────
+// Runs the bench suite to a fixed depth at 1, 2, 4, ... threads (and the
+// largest requested count) and prints CSV: one row per thread count and
+// position, then an "all" row per thread count.
+//   speedup      nodes/sec relative to the one-thread run
+//   dup_ratio    TT hit rate above the one-thread rate: the share of probes
+//                that landed on work another thread had already done
+//   best_changed 1 if the best move differs from the one-thread search
+//                ("all" rows: number of positions that changed)
+//   ttd_<d>      seconds until some thread first completed depth d
+static int run_smp_bench(const BenchOptions& opt) {
+    init_zobrist();
+    tt_resize((size_t)opt.hash_mb);
+    const EngineConfig saved_cfg = get_engine_config();
+    EngineConfig cfg = saved_cfg;
+    cfg.tablebase_dir.clear();
+    set_engine_config(cfg);
+    tb_forget_tables();
+
+    const int max_threads = opt.threads > 0 ? opt.threads : std::max(1, smp_thread_count());
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+    const int depth = std::min(opt.depth, MAX_PLY);
+
+    const std::vector<BenchPosition> suite = bench_suite(opt);
+    for (const BenchPosition& pos : suite) {
+        if (!validate_state(bench_pieces(pos))) {
+            std::cerr << "[bench] invalid position: " << pos.name << "\n";
+            set_engine_config(saved_cfg);
+            return 1;
+        }
+    }
+
+    struct Row {
+        double seconds = 0.0;
+        uint64_t nodes = 0, probes = 0, hits = 0;
+        std::array<double, MAX_PLY + 1> ttd{};
+        MoveTriple best{};
+        int changed = 0;
+        double nps() const { return seconds > 0.0 ? (double)nodes / seconds : 0.0; }
+        double hit_rate() const { return probes ? (double)hits / (double)probes : 0.0; }
+    };
+    std::vector<Row> base(suite.size() + 1); // one-thread rows; the last is the total
+
+    std::cout << "threads,position,depth,nodes,seconds,nps,speedup,tt_hit_rate,dup_ratio,best_move,best_changed";
+    for (int d = 1; d <= depth; d++) std::cout << ",ttd_" << d;
+    std::cout << "\n" << std::fixed;
+
+    auto print_row = [&](int threads, const char* name, const Row& r, const Row& b, bool total) {
+        std::cout << threads << "," << name << "," << depth << "," << r.nodes << ","
+                  << std::setprecision(4) << r.seconds << "," << std::setprecision(0) << r.nps() << ","
+                  << std::setprecision(3) << (b.nps() > 0.0 ? r.nps() / b.nps() : 0.0) << ","
+                  << std::setprecision(4) << r.hit_rate() << "," << std::max(0.0, r.hit_rate() - b.hit_rate()) << ",";
+        if (!total) std::cout << r.best.pid << ":" << (int)r.best.dc << ":" << (int)r.best.dr;
+        std::cout << "," << r.changed;
+        for (int d = 1; d <= depth; d++) {
+            std::cout << ",";
+            if (r.ttd[(std::size_t)d] > 0.0) std::cout << std::setprecision(4) << r.ttd[(std::size_t)d];
+        }
+        std::cout << "\n";
+    };
+
+    for (int threads : thread_counts) {
+        Row total;
+        for (std::size_t i = 0; i < suite.size(); i++) {
+            const BenchPosition& pos = suite[i];
+            tt_clear();
+            reset_search_tables();
+            g_game_rep_history.clear();
+            SMPReport rep;
+            auto t0 = std::chrono::steady_clock::now();
+            AIResult r = smp_search(bench_pieces(pos), pos.to_move, pos.mode, depth, 86400.0, nullptr, threads, &rep);
+            Row row;
+            row.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            row.nodes = rep.nodes;
+            row.probes = rep.tt_probes;
+            row.hits = rep.tt_hits;
+            row.ttd = rep.depth_secs;
+            row.best = r.found ? r.move : MoveTriple{};
+            if (threads == 1) base[i] = row;
+            row.changed = same_move(row.best, base[i].best) ? 0 : 1;
+            print_row(threads, pos.name, row, base[i], false);
+
+            total.seconds += row.seconds;
+            total.nodes += row.nodes;
+            total.probes += row.probes;
+            total.hits += row.hits;
+            total.changed += row.changed;
+            for (int d = 1; d <= depth; d++) total.ttd[(std::size_t)d] += row.ttd[(std::size_t)d];
+        }
+        if (threads == 1) base.back() = total;
+        print_row(threads, "all", total, base.back(), true);
+    }
+
+    set_engine_config(saved_cfg);
+    return 0;
+}
+
+// ── Test-suite runner (--suite) ───────────────────────────────────────────
+// Solves EPD-style positions, one per line:
+//   <position notation> bm <move> [<move> ...]; am <move> ...; id "name";
+// `bm` lists the moves that solve the position and `am` the moves to avoid;
+// other operations, blank lines and '#' comments are ignored. Every position
+// gets a fresh Lazy SMP search with a time and/or node budget. A position is
+// solved from the moment the move the search would play becomes a solution
+// and stays one; time and nodes to solution are counted up to that moment.
+// Where fork() exists, `workers` child processes solve positions in
+// parallel, each with its own copy of the TT and search tables.
+struct SuiteOptions {
+    std::string path;
+    int time_ms = 1000;
+    int nodes = 0;   // node budget per position, 0 = none
+    int threads = 1; // Lazy SMP threads per search
+    int workers = 1; // positions solved at once
+    int hash_mb = 64;
+};
+
+struct SuitePosition {
+    int line = 0;
+    std::string id;
+    PieceList pieces;
+    Player to_move = Player::Red;
+    GameMode mode = GameMode::FULL_BATTLE;
+    std::vector<MoveTriple> best, avoid;
+};
+
+struct SuiteResult {
+    bool solved = false;
+    int depth = 0;
+    MoveTriple move{-1, -1, -1};
+    double secs = 0.0, solve_secs = 0.0;
+    uint64_t nodes = 0, solve_nodes = 0;
+};
+
+static bool load_suite(const std::string& path, std::vector<SuitePosition>& out, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot read " + path;
+        return false;
+    }
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        const std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        const std::string where = path + ":" + std::to_string(n) + ": ";
+        SuitePosition pos;
+        pos.line = n;
+        std::size_t end = 0;
+        std::string why;
+        if (!position_from_text(line, pos.pieces, pos.to_move, pos.mode, &why, &end)) {
+            error = where + why;
+            return false;
+        }
+        std::stringstream ops(line.substr(end));
+        std::string op;
+        while (std::getline(ops, op, ';')) {
+            std::stringstream fields(op);
+            std::string code, operand;
+            if (!(fields >> code)) continue;
+            if (code == "id") {
+                std::getline(fields >> std::ws, operand);
+                while (!operand.empty() && std::isspace((unsigned char)operand.back())) operand.pop_back();
+                if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"')
+                    operand = operand.substr(1, operand.size() - 2);
+                pos.id = operand;
+            } else if (code == "bm" || code == "am") {
+                while (fields >> operand) {
+                    MoveTriple m{};
+                    if (!move_from_text(operand, pos.pieces, pos.to_move, m)) {
+                        error = where + "no single legal move matches '" + operand + "'";
+                        return false;
+                    }
+                    (code == "bm" ? pos.best : pos.avoid).push_back(m);
+                }
+            }
+        }
+        if (pos.best.empty() && pos.avoid.empty()) {
+            error = where + "position has neither bm nor am";
+            return false;
+        }
+        if (pos.id.empty()) pos.id = "line " + std::to_string(n);
+        out.push_back(std::move(pos));
+    }
+    return true;
+}
+
+static SuiteResult solve_suite_position(const SuitePosition& pos, const SuiteOptions& opt) {
+    auto is_solution = [&pos](const MoveTriple& m) {
+        for (const MoveTriple& a : pos.avoid)
+            if (same_move(a, m)) return false;
+        if (pos.best.empty()) return true;
+        for (const MoveTriple& b : pos.best)
+            if (same_move(b, m)) return true;
+        return false;
+    };
+    tt_clear();
+    reset_search_tables();
+    g_game_rep_history.clear();
+
+    const double time_limit = opt.time_ms > 0 ? opt.time_ms / 1000.0 : 86400.0;
+    auto t0 = std::chrono::steady_clock::now();
+    SMPReport rep;
+    AIResult r{false, {}};
+    if (root_shortcut_move(pos.pieces, pos.to_move, pos.mode, time_limit, r)) {
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (r.found) rep.best_changes.push_back({secs, 0, 0, r.move});
+    } else {
+        r = smp_search(pos.pieces, pos.to_move, pos.mode, MAX_PLY, time_limit, nullptr, opt.threads, &rep);
+    }
+
+    SuiteResult res;
+    res.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    res.nodes = rep.nodes;
+    res.depth = rep.depth;
+    if (!r.found) return res;
+    res.move = r.move;
+    if (!is_solution(r.move)) return res;
+    // The earliest change after which every best move was a solution.
+    std::size_t k = rep.best_changes.size();
+    while (k > 0 && is_solution(rep.best_changes[k - 1].move)) k--;
+    res.solved = true;
+    res.solve_secs = k < rep.best_changes.size() ? rep.best_changes[k].secs : res.secs;
+    res.solve_nodes = k < rep.best_changes.size() ? rep.best_changes[k].nodes : res.nodes;
+    return res;
+}
+
+#if COMMANDER_HAS_FORK
+// Forks `workers` children; child w solves positions w, w + workers, ... and
+// streams (index, result) records back through a pipe. `on_result` runs in
+// the parent as each record arrives. False if a worker could not be started
+// or did not report all of its positions.
+static bool run_suite_workers(const std::vector<SuitePosition>& suite, const SuiteOptions& opt, int workers,
+                              std::vector<SuiteResult>& results,
+                              const std::function<void(std::size_t)>& on_result) {
+    struct Record {
+        uint64_t index;
+        SuiteResult result;
+    };
+    std::cout.flush();
+    std::cerr.flush();
+    std::vector<pid_t> pids;
+    std::vector<pollfd> fds;
+    for (int w = 0; w < workers; w++) {
+        int p[2];
+        if (pipe(p) != 0) break;
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(p[0]);
+            close(p[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(p[0]);
+            for (const pollfd& f : fds) close(f.fd);
+            for (std::size_t i = (std::size_t)w; i < suite.size(); i += (std::size_t)workers) {
+                const Record rec{i, solve_suite_position(suite[i], opt)};
+                const char* data = reinterpret_cast<const char*>(&rec);
+                std::size_t left = sizeof(rec);
+                while (left > 0) {
+                    ssize_t n = write(p[1], data, left);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) _exit(1);
+                    data += n;
+                    left -= (std::size_t)n;
+                }
+            }
+            _exit(0);
+        }
+        close(p[1]);
+        pids.push_back(pid);
+        fds.push_back({p[0], POLLIN, 0});
+    }
+    bool ok = (int)pids.size() == workers;
+    if (!ok) {
+        for (pid_t pid : pids) kill(pid, SIGKILL);
+    }
+
+    std::vector<std::string> pending(fds.size());
+    std::vector<uint8_t> received(suite.size(), 0);
+    std::size_t open = ok ? fds.size() : 0;
+    while (open > 0) {
+        if (poll(fds.data(), (nfds_t)fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        for (std::size_t k = 0; k < fds.size(); k++) {
+            if (fds[k].fd < 0 || fds[k].revents == 0) continue;
+            char buf[4096];
+            ssize_t n = read(fds[k].fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                close(fds[k].fd);
+                fds[k].fd = -1;
+                open--;
+                continue;
+            }
+            pending[k].append(buf, (std::size_t)n);
+            while (pending[k].size() >= sizeof(Record)) {
+                Record rec;
+                std::memcpy(&rec, pending[k].data(), sizeof(rec));
+                pending[k].erase(0, sizeof(rec));
+                if (rec.index >= suite.size()) continue;
+                results[(std::size_t)rec.index] = rec.result;
+                received[(std::size_t)rec.index] = 1;
+                on_result((std::size_t)rec.index);
+            }
+        }
+    }
+    for (const pollfd& f : fds)
+        if (f.fd >= 0) close(f.fd);
+    for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+    return ok && std::all_of(received.begin(), received.end(), [](uint8_t r) { return r != 0; });
+}
+#endif
+
+static int run_suite(const SuiteOptions& opt) {
+    init_zobrist();
+    std::vector<SuitePosition> suite;
+    std::string error;
+    if (!load_suite(opt.path, suite, error)) {
+        std::cerr << "[suite] " << error << "\n";
+        return 1;
+    }
+    if (suite.empty()) {
+        std::cerr << "[suite] no positions in " << opt.path << "\n";
+        return 1;
+    }
+    tt_resize((size_t)opt.hash_mb);
+    const bool prev_book = g_use_opening_book;
+    g_use_opening_book = false; // a book move says nothing about search strength
+    g_search_node_limit.store((uint64_t)opt.nodes, std::memory_order_relaxed);
+
+    std::vector<SuiteResult> results(suite.size());
+    auto print_result = [&](std::size_t i) {
+        const SuitePosition& pos = suite[i];
+        const SuiteResult& r = results[i];
+        std::cout << "Position " << (i + 1) << "/" << suite.size() << " (" << pos.id << "): ";
+        if (r.solved)
+            std::cout << "solved in " << std::setprecision(3) << r.solve_secs << " s, " << r.solve_nodes << " nodes";
+        else
+            std::cout << "FAILED";
+        std::cout << "; played " << (r.move.pid >= 0 ? move_to_text(pos.pieces, r.move) : "none")
+                  << " at depth " << r.depth << "\n" << std::flush;
+    };
+
+    std::cout << std::fixed;
+#if COMMANDER_HAS_FORK
+    const int workers = std::max(1, std::min(opt.workers, (int)suite.size()));
+#else
+    const int workers = 1; // no fork(): solve everything in this process
+#endif
+    bool ok = true;
+    auto t0 = std::chrono::steady_clock::now();
+    if (workers > 1) {
+#if COMMANDER_HAS_FORK
+        ok = run_suite_workers(suite, opt, workers, results, print_result);
+#endif
+    } else {
+        for (std::size_t i = 0; i < suite.size(); i++) {
+            results[i] = solve_suite_position(suite[i], opt);
+            print_result(i);
+        }
+    }
+    const double wall_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    g_search_node_limit.store(0, std::memory_order_relaxed);
+    g_use_opening_book = prev_book;
+    if (!ok) {
+        std::cerr << "[suite] a worker process failed\n";
+        return 1;
+    }
+
+    int solved = 0;
+    double solve_secs = 0.0, search_secs = 0.0;
+    uint64_t solve_nodes = 0, search_nodes = 0;
+    for (const SuiteResult& r : results) {
+        search_secs += r.secs;
+        search_nodes += r.nodes;
+        if (!r.solved) continue;
+        solved++;
+        solve_secs += r.solve_secs;
+        solve_nodes += r.solve_nodes;
+    }
+    const double cpu_secs = search_secs * opt.threads;
+    std::cout << "===========================\n"
+              << "Solved            : " << solved << "/" << suite.size() << "\n"
+              << "Time to solution  : " << std::setprecision(3) << solve_secs << " s total, "
+              << (solved ? solve_secs / solved : 0.0) << " s mean\n"
+              << "Nodes to solution : " << solve_nodes << " total, " << (solved ? solve_nodes / (uint64_t)solved : 0)
+              << " mean\n"
+              << "Nodes searched    : " << search_nodes << "\n"
+              << "Search time       : " << wall_secs << " s wall, " << cpu_secs << " s CPU ("
+              << workers << " workers x " << opt.threads << " threads)\n"
+              << "Solved/CPU-minute : " << std::setprecision(2) << (cpu_secs > 0.0 ? solved * 60.0 / cpu_secs : 0.0) << "\n";
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     std::atexit(tt_arena_release);
     SimOptions sim;
     bool saw_sim_option = false;
     std::string eval_backend_mode = "auto";
+    std::string tb_gen_dir;
+    int tb_units = 1;
+    int tb_max_mb = 64;
+    BookGenOptions book_gen;
+    BenchOptions bench;
+    SuiteOptions suite;
+    std::string position;
 
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -7576,6 +10984,110 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             eval_backend_mode = argv[++i];
+        } else if (arg == "--position") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --position\n";
+                print_usage(argv[0]);
+                return 1;
+            }
+            position = argv[++i];
+            PieceList pieces;
+            Player turn = Player::Red;
+            GameMode mode = GameMode::FULL_BATTLE;
+            std::string why;
+            if (!parse_start_position(position, pieces, turn, mode, &why)) {
+                std::cerr << "Invalid --position: " << why << "\n";
+                return 1;
+            }
+        } else if (arg == "--tb-dir" || arg == "--tb-gen") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                print_usage(argv[0]);
+                return 1;
+            }
+            if (arg == "--tb-gen") {
+                tb_gen_dir = argv[++i];
+            } else {
+                EngineConfig cfg = get_engine_config();
+                cfg.tablebase_dir = argv[++i];
+                set_engine_config(cfg);
+            }
+        } else if (arg == "--book" || arg == "--book-gen" || arg == "--book-mode") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                print_usage(argv[0]);
+                return 1;
+            }
+            std::string v = argv[++i];
+            if (arg == "--book-gen") {
+                book_gen.path = v;
+            } else if (arg == "--book-mode") {
+                if (!parse_game_mode_token(v, book_gen.mode)) {
+                    std::cerr << "--book-mode must be one of: full, marine, air, land\n";
+                    return 1;
+                }
+            } else {
+                EngineConfig cfg = get_engine_config();
+                cfg.opening_book_path = v;
+                set_engine_config(cfg);
+            }
+        } else if (arg == "--book-games" || arg == "--book-plies" ||
+                   arg == "--book-depth" || arg == "--book-time-ms") {
+            int v = 0;
+            if (i + 1 >= argc || !parse_i32_arg(argv[++i], v) || v <= 0) {
+                std::cerr << "Invalid value for " << arg << "\n";
+                return 1;
+            }
+            if (arg == "--book-games") book_gen.games = v;
+            else if (arg == "--book-plies") book_gen.plies = v;
+            else if (arg == "--book-depth") book_gen.depth = v;
+            else book_gen.time_ms = v;
+        } else if (arg == "--tb-units" || arg == "--tb-max-mb") {
+            int v = 0;
+            if (i + 1 >= argc || !parse_i32_arg(argv[++i], v) || v < 0) {
+                std::cerr << "Invalid value for " << arg << "\n";
+                return 1;
+            }
+            if (arg == "--tb-units") tb_units = v;
+            else tb_max_mb = v;
+        } else if (arg == "--bench" || arg == "--bench-smp") {
+            // Optional positional values: [depth] [threads] [hash]
+            bench.enabled = true;
+            if (arg == "--bench-smp") {
+                bench.smp_scaling = true;
+                bench.threads = 0;
+            }
+            int* fields[] = {&bench.depth, &bench.threads, &bench.hash_mb};
+            for (int* field : fields) {
+                int v = 0;
+                if (i + 1 >= argc || !parse_i32_arg(argv[i + 1], v)) break;
+                if (v <= 0) {
+                    std::cerr << "--bench values must be > 0\n";
+                    return 1;
+                }
+                *field = v;
+                i++;
+            }
+        } else if (arg == "--suite") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for --suite\n";
+                print_usage(argv[0]);
+                return 1;
+            }
+            suite.path = argv[++i];
+        } else if (arg == "--suite-time-ms" || arg == "--suite-nodes" || arg == "--suite-threads" ||
+                   arg == "--suite-workers" || arg == "--suite-hash") {
+            int v = 0;
+            const bool may_be_zero = (arg == "--suite-time-ms" || arg == "--suite-nodes");
+            if (i + 1 >= argc || !parse_i32_arg(argv[++i], v) || v < 0 || (v == 0 && !may_be_zero)) {
+                std::cerr << "Invalid value for " << arg << "\n";
+                return 1;
+            }
+            if (arg == "--suite-time-ms") suite.time_ms = v;
+            else if (arg == "--suite-nodes") suite.nodes = v;
+            else if (arg == "--suite-threads") suite.threads = v;
+            else if (arg == "--suite-workers") suite.workers = v;
+            else suite.hash_mb = v;
         } else if (arg == "--sim") {
             sim.enabled = true;
         } else if (arg == "--mcts") {
@@ -7629,6 +11141,18 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (!position.empty()) {
+        if (book_gen.path.empty() && !sim.enabled && !bench.enabled) {
+            std::cerr << "--position requires --sim, --book-gen, --bench or --bench-smp\n";
+            return 1;
+        }
+        sim.position = book_gen.position = bench.position = position;
+    }
+    if (!book_gen.path.empty()) return run_book_builder(book_gen);
+    if (!tb_gen_dir.empty()) {
+        init_zobrist();
+        return tb_generate_all(tb_gen_dir, tb_units, tb_max_mb, std::cerr);
+    }
     if (!sim.enabled && saw_sim_option) {
         std::cerr << "Simulation options require --sim\n";
         print_usage(argv[0]);
@@ -7645,6 +11169,14 @@ int main(int argc, char* argv[]) {
         std::cerr << "[eval] " << eval_note << "\n";
     }
     std::cerr << "[eval] active backend: " << eval_backend_name(active_eval_backend()) << "\n";
+    if (!suite.path.empty()) {
+        if (suite.time_ms == 0 && suite.nodes == 0) {
+            std::cerr << "--suite needs a time or node budget\n";
+            return 1;
+        }
+        return run_suite(suite);
+    }
+    if (bench.enabled) return bench.smp_scaling ? run_smp_bench(bench) : run_bench(bench);
     if (sim.enabled) return run_headless_sim(sim);
 
     SDL_SetMainReady();
@@ -0,0 +1,294 @@
+/*
+ * commander_microbench — per-kernel timings for the Commander Chess engine.
+ *
+ * Times the engine's hot kernels one at a time over a corpus of recorded
+ * positions: the --bench suite plus positions sampled from seeded self-play.
+ * Every kernel is measured in several independent samples and reported as
+ * ns/op (median, mean, relative stddev, min and max), so a regression can be
+ * traced to the kernel that caused it instead of only showing up end to end.
+ *
+ *   commander_microbench [--samples N] [--games G] [--filter SUBSTR]
+ *
+ * The engine is compiled into this binary the same way backend/engine.cpp
+ * does it: the whole translation unit is included with its GUI entry point
+ * renamed.
+ */
+#define main commander_chess_gui_main
+#include "commander_chess.cpp"
+#undef main
+
+namespace {
+
+struct CorpusPosition {
+    PieceList pieces;
+    Player turn = Player::Red;
+    SearchState st;
+    AllMoves moves;       // legal for `st`
+    AllMoves captures;    // subset of `moves` landing on an enemy piece
+};
+
+struct MicrobenchOptions {
+    int samples = 10;
+    int games = 16;
+    std::string filter;
+};
+
+static volatile uint64_t g_microbench_sink = 0;
+
+static void add_corpus_position(std::vector<CorpusPosition>& corpus, const PieceList& pieces,
+                                Player turn, GameMode mode) {
+    CorpusPosition cp;
+    cp.pieces = pieces;
+    cp.turn = turn;
+    cp.st = make_search_state(pieces, turn, turn, mode);
+    for (const MoveTriple& m : all_moves_for(pieces, turn)) {
+        int pi = find_piece_idx_by_id_fast(cp.st, m.pid);
+        if (pi < 0 || !piece_move_is_pseudo_legal(cp.st, cp.st.pieces[pi], m.dc, m.dr)) continue;
+        cp.moves.push_back(m);
+        const Piece* target = piece_at_c(pieces, m.dc, m.dr);
+        if (target && target->player != turn) cp.captures.push_back(m);
+    }
+    if (cp.moves.empty()) return;
+    corpus.push_back(std::move(cp));
+}
+
+// The --bench suite, then every third position of `games` seeded self-play
+// games that prefer captures half of the time.
+static std::vector<CorpusPosition> build_corpus(int games) {
+    std::vector<CorpusPosition> corpus;
+    for (const BenchPosition& pos : bench_positions()) {
+        PieceList pieces = bench_pieces(pos);
+        if (validate_state(pieces)) add_corpus_position(corpus, pieces, pos.to_move, pos.mode);
+    }
+    for (int g = 0; g < games; g++) {
+        std::mt19937 rng((uint32_t)g + 1);
+        PieceList pieces = make_initial_pieces();
+        Player turn = (g % 2 == 0) ? Player::Red : Player::Blue;
+        for (int ply = 0; ply < 160; ply++) {
+            AllMoves moves = all_moves_for(pieces, turn);
+            if (moves.empty()) break;
+            if (ply % 3 == 0) add_corpus_position(corpus, pieces, turn, GameMode::FULL_BATTLE);
+            AllMoves captures;
+            for (const MoveTriple& m : moves) {
+                const Piece* target = piece_at_c(pieces, m.dc, m.dr);
+                if (target && target->player != turn) captures.push_back(m);
+            }
+            const AllMoves& pool = (!captures.empty() && (rng() & 1)) ? captures : moves;
+            const MoveTriple m = pool[(std::size_t)(rng() % (uint32_t)pool.size())];
+            pieces = apply_move(pieces, m.pid, m.dc, m.dr, turn);
+            if (side_has_won(pieces, turn, GameMode::FULL_BATTLE)) break;
+            turn = opp(turn);
+        }
+    }
+    return corpus;
+}
+
+struct KernelStats {
+    double median = 0, mean = 0, stddev = 0, min = 0, max = 0;
+};
+
+// `pass` runs the kernel over the corpus once and returns the number of
+// operations it performed. Each sample repeats the pass for roughly 20 ms.
+template <typename Pass>
+static KernelStats measure(Pass&& pass, int samples) {
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    uint64_t ops = pass(); // warm-up, also sizes the samples
+    double pass_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+    if (ops == 0) return {};
+    int reps = std::max(1, (int)(20e6 / std::max(1.0, pass_ns)));
+
+    std::vector<double> ns_per_op;
+    ns_per_op.reserve((std::size_t)samples);
+    for (int s = 0; s < samples; s++) {
+        uint64_t total = 0;
+        auto s0 = clock::now();
+        for (int r = 0; r < reps; r++) total += pass();
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - s0).count();
+        ns_per_op.push_back(ns / (double)std::max<uint64_t>(1, total));
+    }
+
+    KernelStats k;
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    k.min = ns_per_op.front();
+    k.max = ns_per_op.back();
+    k.median = ns_per_op[ns_per_op.size() / 2];
+    for (double v : ns_per_op) k.mean += v;
+    k.mean /= (double)ns_per_op.size();
+    for (double v : ns_per_op) k.stddev += (v - k.mean) * (v - k.mean);
+    k.stddev = std::sqrt(k.stddev / (double)ns_per_op.size());
+    return k;
+}
+
+static int run_microbench(const MicrobenchOptions& opt) {
+    init_zobrist();
+    tt_resize(64);
+    EngineConfig cfg = get_engine_config();
+    cfg.tablebase_dir.clear();
+    set_engine_config(cfg);
+
+    std::vector<CorpusPosition> corpus = build_corpus(opt.games);
+    if (corpus.empty()) {
+        std::cerr << "[microbench] empty corpus\n";
+        return 1;
+    }
+    std::vector<MoveGenContext> contexts;
+    contexts.reserve(corpus.size());
+    std::size_t total_pieces = 0, total_moves = 0;
+    for (CorpusPosition& cp : corpus) {
+        contexts.push_back(build_movegen_context(cp.pieces));
+        ensure_attack_cache(cp.st);
+        total_pieces += cp.pieces.size();
+        total_moves += cp.moves.size();
+    }
+    std::printf("corpus: %zu positions, %.1f pieces and %.1f legal moves on average\n\n",
+                corpus.size(), (double)total_pieces / (double)corpus.size(),
+                (double)total_moves / (double)corpus.size());
+    std::printf("%-40s %10s %10s %8s %10s %10s\n", "kernel", "median", "mean", "stddev", "min", "max");
+    std::printf("%-40s %10s %10s %8s %10s %10s\n", "", "ns/op", "ns/op", "%", "ns/op", "ns/op");
+
+    auto report = [&](const std::string& name, auto&& pass) {
+        if (!opt.filter.empty() && name.find(opt.filter) == std::string::npos) return;
+        KernelStats k = measure(pass, opt.samples);
+        double rel = k.mean > 0 ? 100.0 * k.stddev / k.mean : 0.0;
+        std::printf("%-40s %10.1f %10.1f %7.1f%% %10.1f %10.1f\n",
+                    name.c_str(), k.median, k.mean, rel, k.min, k.max);
+    };
+
+    report("zobrist_hash", [&]() -> uint64_t {
+        uint64_t sink = 0;
+        for (const CorpusPosition& cp : corpus) sink ^= zobrist_hash(cp.pieces, cp.turn);
+        g_microbench_sink = g_microbench_sink + sink;
+        return corpus.size();
+    });
+
+    report("build_movegen_context", [&]() -> uint64_t {
+        uint64_t sink = 0;
+        for (const CorpusPosition& cp : corpus) sink += build_movegen_context(cp.pieces).occ_all.w[0];
+        g_microbench_sink = g_microbench_sink + sink;
+        return corpus.size();
+    });
+
+    for (int k = (int)PieceKind::HQ; k <= (int)PieceKind::Navy; k++) {
+        const PieceKind kind = (PieceKind)k;
+        std::vector<std::pair<std::size_t, std::size_t>> sites; // (position, piece)
+        for (std::size_t i = 0; i < corpus.size(); i++)
+            for (std::size_t j = 0; j < corpus[i].pieces.size(); j++)
+                if (corpus[i].pieces[j].kind == kind) sites.emplace_back(i, j);
+        if (sites.empty()) continue;
+        report("get_move_mask_bitboard/" + kind_to_string(kind), [&]() -> uint64_t {
+            uint64_t sink = 0;
+            for (const auto& s : sites)
+                sink += get_move_mask_bitboard(corpus[s.first].pieces[s.second], contexts[s.first]).w[0];
+            g_microbench_sink = g_microbench_sink + sink;
+            return sites.size();
+        });
+    }
+
+    report("all_moves_for", [&]() -> uint64_t {
+        uint64_t sink = 0;
+        for (const CorpusPosition& cp : corpus) sink += all_moves_for(cp.pieces, cp.turn).size();
+        g_microbench_sink = g_microbench_sink + sink;
+        return corpus.size();
+    });
+
+    report("make+unmake (snapshot)", [&]() -> uint64_t {
+        uint64_t ops = 0;
+        for (CorpusPosition& cp : corpus) {
+            for (const MoveTriple& m : cp.moves) {
+                UndoMove u;
+                if (!make_move_inplace_snapshot(cp.st, m, cp.turn, u)) continue;
+                unmake_move_inplace(cp.st, u);
+                ops++;
+            }
+        }
+        return ops;
+    });
+
+    report("make+unmake (search)", [&]() -> uint64_t {
+        uint64_t ops = 0;
+        for (CorpusPosition& cp : corpus) {
+            for (const MoveTriple& m : cp.moves) {
+                UndoMove u;
+                if (!make_move_inplace_search(cp.st, m, cp.turn, u)) continue;
+                unmake_move_inplace(cp.st, u);
+                ops++;
+            }
+        }
+        return ops;
+    });
+
+    report("see", [&]() -> uint64_t {
+        uint64_t sink = 0, ops = 0;
+        for (const CorpusPosition& cp : corpus) {
+            for (const MoveTriple& m : cp.captures) {
+                sink += (uint64_t)see(cp.pieces, m.dc, m.dr, cp.turn);
+                ops++;
+            }
+        }
+        g_microbench_sink = g_microbench_sink + sink;
+        return ops;
+    });
+
+    report("build_attack_cache", [&]() -> uint64_t {
+        uint64_t sink = 0;
+        for (CorpusPosition& cp : corpus) {
+            cp.st.atk.valid = false;
+            build_attack_cache(cp.st);
+            sink += (uint64_t)cp.st.atk.attacked_square_count[0];
+        }
+        g_microbench_sink = g_microbench_sink + sink;
+        return corpus.size();
+    });
+
+    report("board_score_cpu_impl", [&]() -> uint64_t {
+        uint64_t sink = 0;
+        for (const CorpusPosition& cp : corpus)
+            sink += (uint64_t)board_score_cpu_impl(cp.st.pieces, cp.turn, &cp.st.atk, &cp.turn, &cp.st);
+        g_microbench_sink = g_microbench_sink + sink;
+        return corpus.size();
+    });
+
+    report("tt_store", [&]() -> uint64_t {
+        for (const CorpusPosition& cp : corpus)
+            tt_store(cp.st.hash, 4, TT_EXACT, (int)(cp.st.hash & 0xFF), cp.moves[0]);
+        return corpus.size();
+    });
+
+    report("tt_probe", [&]() -> uint64_t {
+        uint64_t sink = 0;
+        for (const CorpusPosition& cp : corpus) {
+            const TTDecoded* e = tt_probe(cp.st.hash, nullptr);
+            if (e) sink += (uint64_t)e->depth;
+        }
+        g_microbench_sink = g_microbench_sink + sink;
+        return corpus.size();
+    });
+
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::atexit(tt_arena_release);
+    MicrobenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--samples" || arg == "--games") && i + 1 < argc) {
+            int v = 0;
+            if (!parse_i32_arg(argv[++i], v) || v <= 0) {
+                std::cerr << "Invalid value for " << arg << "\n";
+                return 1;
+            }
+            if (arg == "--samples") opt.samples = v;
+            else opt.games = v;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            opt.filter = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--samples N] [--games G] [--filter SUBSTR]\n";
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    return run_microbench(opt);
+}
@@ -61,6 +61,28 @@ async function ensureApi() {
   return api;
 }
 
+// Optional binary opening book shipped next to the engine. Older engine
+// builds without cc_load_opening_book simply keep the built-in book.
+async function loadOpeningBook() {
+  if (!moduleInstance || typeof moduleInstance._cc_load_opening_book !== 'function' ||
+      typeof moduleInstance._malloc !== 'function') {
+    return false;
+  }
+  try {
+    const res = await fetch('/engine/opening_book.ccbk' + q);
+    if (!res.ok) return false;
+    const bytes = new Uint8Array(await res.arrayBuffer());
+    if (bytes.length === 0) return false;
+    const ptr = moduleInstance._malloc(bytes.length);
+    moduleInstance.HEAPU8.set(bytes, ptr);
+    const ok = moduleInstance._cc_load_opening_book(ptr, bytes.length);
+    moduleInstance._free(ptr);
+    return !!ok;
+  } catch (_) {
+    return false;
+  }
+}
+
 function readLastError(apiRef, fallback) {
   try {
     const msg = apiRef.getLastError();
@@ -77,7 +99,8 @@ async function handleCommand(cmd, payload) {
   if (cmd === 'init') {
     const ok = core.init();
     if (!ok) throw new Error(readLastError(core, 'cc_init failed'));
-    return { ok: true };
+    const openingBook = await loadOpeningBook();
+    return { ok: true, openingBook };
   }
 
   if (cmd === 'newGame') {
@@ -91,7 +114,8 @@ async function handleCommand(cmd, payload) {
 
   if (cmd === 'setPosition') {
     const state = payload && payload.state ? payload.state : {};
-    const ok = core.setPosition(JSON.stringify(state));
+    // A string is compact position notation; objects are serialized state JSON.
+    const ok = core.setPosition(typeof state === 'string' ? state : JSON.stringify(state));
     if (!ok) throw new Error(readLastError(core, 'cc_set_position failed'));
     return parseJsonOrThrow(core.getPosition(), 'cc_get_position');
   }